@@ -22,6 +22,8 @@ bootmain(void)
 	void (*entry)(void);
 	uchar* pa;
 
+	*(uint64*)BOOTTSC = rdtsc();  // for bootstat
+
 	elf = (struct elfhdr*)0x10000;  // scratch space
 
 	// Read 1st page off disk
@@ -43,11 +45,11 @@ bootmain(void)
 
 	// Call the entry point from the ELF header.
 	// Does not return!
-	entry = (void(*)(void))(V2P(elf->entry));
+	entry = (void(*)(void))(elf->entry);
 	entry();
 }
 
-void
+static void
 waitdisk(void)
 {
 	// Wait for disk ready.
@@ -55,42 +57,40 @@ waitdisk(void)
 		;
 }
 
-// Read a single sector at offset into dst.
-void
-readsect(void *dst, uint offset)
-{
-	// Issue command.
-	waitdisk();
-	outb(0x1F2, 1);   // count = 1
-	outb(0x1F3, offset);
-	outb(0x1F4, offset >> 8);
-	outb(0x1F5, offset >> 16);
-	outb(0x1F6, (offset >> 24) | 0xE0);
-	outb(0x1F7, 0x20);  // cmd 0x20 - read sectors
-
-	// Read data.
-	waitdisk();
-	insl(0x1F0, dst, SECTSIZE/4);
-}
-
 // Read 'count' bytes at 'offset' from kernel into physical address 'pa'.
 // Might copy more than asked.
 void
 readseg(uchar* pa, uint count, uint offset)
 {
-	uchar* epa;
-
-	epa = pa + count;
+	uint n;
 
 	// Round down to sector boundary.
+	count += offset % SECTSIZE;
 	pa -= offset % SECTSIZE;
 
 	// Translate from bytes to sectors; kernel starts at sector 1.
 	offset = (offset / SECTSIZE) + 1;
-
-	// If this is too slow, we could read lots of sectors at a time.
-	// We'd write more to memory than asked, but it doesn't matter --
-	// we load in increasing order.
-	for(; pa < epa; pa += SECTSIZE, offset++)
-		readsect(pa, offset);
+	count = (count + SECTSIZE - 1) / SECTSIZE;
+
+	// Read up to 256 sectors with each command.
+	while(count > 0){
+		n = count < 256 ? count : 256;
+		waitdisk();
+		outb(0x1F2, n);   // 256 is sent as 0, which means 256
+		outb(0x1F3, offset);
+		outb(0x1F4, offset >> 8);
+		outb(0x1F5, offset >> 16);
+		outb(0x1F6, 0xE0);  // LBA28, with bits 24-27 of the sector number 0
+		outb(0x1F7, 0x20);  // cmd 0x20 - read sectors
+		offset += n;
+		count -= n;
+
+		// Read data, a sector each time the drive has one ready:
+		// not busy, and DRQ set.
+		for(; n > 0; n--, pa += SECTSIZE){
+			while((inb(0x1F7) & 0x88) != 0x08)
+				;
+			insl(0x1F0, pa, SECTSIZE/4);
+		}
+	}
 }
@@ -0,0 +1,125 @@
+// ACPI processor discovery.
+// Enumerate processors and the I/O APIC from the MADT, which
+// unlike the MP tables can describe CPUs with x2APIC IDs.
+// See ACPI Specification 6.x, section 5.2.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "acpi.h"
+
+static uchar
+sum(uchar *addr, int len)
+{
+	int i, sum;
+
+	sum = 0;
+	for(i=0; i<len; i++)
+		sum += addr[i];
+	return sum;
+}
+
+// Look for the RSDP in the len bytes at physical address a.
+// It lies on a 16-byte boundary.
+static struct acpirsdp*
+rsdpsearch1(uint a, int len)
+{
+	uchar *e, *p, *addr;
+
+	addr = P2V(a);
+	e = addr+len;
+	for(p = addr; p < e; p += 16)
+		if(memcmp(p, "RSD PTR ", 8) == 0 && sum(p, sizeof(struct acpirsdp)) == 0)
+			return (struct acpirsdp*)p;
+	return 0;
+}
+
+// The RSDP is in the first KB of the EBDA or in the BIOS ROM
+// between 0xE0000 and 0xFFFFF.
+static struct acpirsdp*
+rsdpsearch(void)
+{
+	uchar *bda;
+	uint p;
+	struct acpirsdp *rsdp;
+
+	bda = (uchar *) P2V(0x400);
+	if((p = ((bda[0x0F]<<8)| bda[0x0E]) << 4))
+		if((rsdp = rsdpsearch1(p, 1024)))
+			return rsdp;
+	return rsdpsearch1(0xE0000, 0x20000);
+}
+
+// Map the table at physical address pa and check it.
+// Firmware often puts the tables at the top of RAM,
+// above PHYSTOP, so map the header before reading the length.
+static struct acpisdt*
+sdtmap(uint pa)
+{
+	struct acpisdt *h;
+
+	h = kmapphys(pa, sizeof(*h));
+	if(h->length < sizeof(*h))
+		return 0;
+	h = kmapphys(pa, h->length);
+	if(sum((uchar*)h, h->length) != 0)
+		return 0;
+	return h;
+}
+
+// Find the MADT through the RSDT.
+static struct acpimadt*
+madtsearch(void)
+{
+	struct acpirsdp *rsdp;
+	struct acpisdt *rsdt, *h;
+	uint *pa, *e;
+
+	if((rsdp = rsdpsearch()) == 0)
+		return 0;
+	if((rsdt = sdtmap(rsdp->rsdt)) == 0 || memcmp(rsdt->signature, "RSDT", 4) != 0)
+		return 0;
+	e = (uint*)((uchar*)rsdt + rsdt->length);
+	for(pa = (uint*)(rsdt+1); pa < e; pa++)
+		if((h = sdtmap(*pa)) != 0 && memcmp(h->signature, "APIC", 4) == 0)
+			return (struct acpimadt*)h;
+	return 0;
+}
+
+// Register the processors and I/O APIC that the MADT lists.
+// Returns -1, having registered nothing, if there is no MADT.
+int
+acpiinit(void)
+{
+	struct acpimadt *madt;
+	struct madtlapic *lp;
+	struct madtx2apic *x2;
+	struct madtioapic *io;
+	uchar *p, *e;
+
+	if((madt = madtsearch()) == 0)
+		return -1;
+	lapic = (uint*)madt->lapicaddr;
+	e = (uchar*)madt + madt->hdr.length;
+	for(p = (uchar*)(madt+1); p + 2 <= e && p[1] >= 2; p += p[1]){
+		switch(p[0]){
+		case MADT_LAPIC:
+			lp = (struct madtlapic*)p;
+			if(lp->flags & MADT_ENABLED)
+				mpaddcpu(lp->apicid);
+			break;
+		case MADT_X2APIC:
+			x2 = (struct madtx2apic*)p;
+			if(x2->flags & MADT_ENABLED)
+				mpaddcpu(x2->apicid);
+			break;
+		case MADT_IOAPIC:
+			io = (struct madtioapic*)p;
+			if(io->gsibase == 0)
+				ioapicid = io->ioapicid;
+			break;
+		}
+	}
+	return 0;
+}
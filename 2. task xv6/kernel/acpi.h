@@ -0,0 +1,59 @@
+// See ACPI Specification 6.x, section 5.2.
+
+struct acpirsdp {       // root system description pointer
+	uchar signature[8];           // "RSD PTR "
+	uchar checksum;               // first 20 bytes add up to 0
+	uchar oemid[6];
+	uchar revision;               // 0 for ACPI 1.0, 2 for later
+	uint rsdt;                    // phys addr of RSDT
+};
+
+struct acpisdt {        // system description table header
+	uchar signature[4];
+	uint length;                  // total table length
+	uchar revision;
+	uchar checksum;               // all bytes must add up to 0
+	uchar oemid[6];
+	uchar oemtableid[8];
+	uint oemrevision;
+	uint creatorid;
+	uint creatorrevision;
+};                              // RSDT: followed by phys addrs of tables
+
+struct acpimadt {       // multiple APIC description table
+	struct acpisdt hdr;           // "APIC"
+	uint lapicaddr;               // phys addr of local APIC
+	uint flags;
+};                              // followed by variable-length entries
+
+struct madtlapic {      // processor local APIC entry
+	uchar type;                   // entry type (0)
+	uchar length;                 // 8
+	uchar procid;                 // ACPI processor UID
+	uchar apicid;                 // local APIC id
+	uint flags;
+		#define MADT_ENABLED 0x01     // Processor is usable
+};
+
+struct madtioapic {     // I/O APIC entry
+	uchar type;                   // entry type (1)
+	uchar length;                 // 12
+	uchar ioapicid;               // I/O APIC id
+	uchar reserved;
+	uint addr;                    // I/O APIC address
+	uint gsibase;                 // first interrupt it handles
+};
+
+struct madtx2apic {     // processor local x2APIC entry
+	uchar type;                   // entry type (9)
+	uchar length;                 // 16
+	ushort reserved;
+	uint apicid;                  // local x2APIC id
+	uint flags;                   // as for madtlapic
+	uint procuid;                 // ACPI processor UID
+};
+
+// MADT entry types
+#define MADT_LAPIC   0x00  // One per processor with an 8-bit APIC id
+#define MADT_IOAPIC  0x01  // One per I/O APIC
+#define MADT_X2APIC  0x09  // One per processor with a larger APIC id
@@ -17,10 +17,16 @@
 // * B_VALID: the buffer data has been read from the disk.
 // * B_DIRTY: the buffer data has been modified
 //     and needs to be written to disk.
+//
+// bcache.lock protects the LRU list and the recycling of
+// buffers.  A block that is already cached is usually found by
+// bfind() without the lock; refcnt is therefore only changed
+// by atomic instructions.
 
 #include "types.h"
 #include "defs.h"
 #include "param.h"
+#include "mmu.h"
 #include "spinlock.h"
 #include "sleeplock.h"
 #include "fs.h"
@@ -28,7 +34,7 @@
 
 struct {
 	struct spinlock lock;
-	struct buf buf[NBUF];
+	struct buf *buf;  // nbuf of them, from kallocn
 
 	// Linked list of all buffers, through prev/next.
 	// head.next is most recently used.
@@ -39,13 +45,18 @@ void
 binit(void)
 {
 	struct buf *b;
+	int n;
 
 	initlock(&bcache.lock, "bcache");
+	n = PGROUNDUP(nbuf * sizeof(struct buf)) / PGSIZE;
+	if((bcache.buf = (struct buf*)kallocn(n)) == 0)
+		panic("binit: no memory");
+	memset(bcache.buf, 0, n * PGSIZE);
 
 	// Create linked list of buffers
 	bcache.head.prev = &bcache.head;
 	bcache.head.next = &bcache.head;
-	for(b = bcache.buf; b < bcache.buf+NBUF; b++){
+	for(b = bcache.buf; b < bcache.buf+nbuf; b++){
 		b->next = bcache.head.next;
 		b->prev = &bcache.head;
 		initsleeplock(&b->lock, "buffer");
@@ -54,6 +65,32 @@ binit(void)
 	}
 }
 
+// Look for a cached copy of the block without bcache.lock and
+// pin it, or return 0.  Buffers are never freed, but one with
+// refcnt zero can be recycled for another block at any time, so
+// a hit must pin the buffer and then check that no recycle began
+// since it looked: bget() makes b->seq odd before claiming a
+// buffer and even again once it is relabelled.
+static struct buf*
+bfind(uint dev, uint blockno)
+{
+	struct buf *b;
+	uint seq;
+
+	for(b = bcache.buf; b < bcache.buf+nbuf; b++){
+		seq = b->seq;
+		if((seq & 1) || b->dev != dev || b->blockno != blockno)
+			continue;
+		__sync_fetch_and_add(&b->refcnt, 1);
+		if(b->seq == seq)
+			return b;
+		// Lost a race with recycling; let bget() sort it out.
+		__sync_fetch_and_sub(&b->refcnt, 1);
+		return 0;
+	}
+	return 0;
+}
+
 // Look through buffer cache for block on device dev.
 // If not found, allocate a buffer.
 // In either case, return locked buffer.
@@ -62,12 +99,17 @@ bget(uint dev, uint blockno)
 {
 	struct buf *b;
 
+	if((b = bfind(dev, blockno)) != 0){
+		acquiresleep(&b->lock);
+		return b;
+	}
+
 	acquire(&bcache.lock);
 
 	// Is the block already cached?
 	for(b = bcache.head.next; b != &bcache.head; b = b->next){
 		if(b->dev == dev && b->blockno == blockno){
-			b->refcnt++;
+			__sync_fetch_and_add(&b->refcnt, 1);
 			release(&bcache.lock);
 			acquiresleep(&b->lock);
 			return b;
@@ -79,10 +121,16 @@ bget(uint dev, uint blockno)
 	// because log.c has modified it but not yet committed it.
 	for(b = bcache.head.prev; b != &bcache.head; b = b->prev){
 		if(b->refcnt == 0 && (b->flags & B_DIRTY) == 0) {
+			b->seq++;
+			if(!__sync_bool_compare_and_swap(&b->refcnt, 0, 1)){
+				b->seq++;  // bfind() pinned it meanwhile
+				continue;
+			}
 			b->dev = dev;
 			b->blockno = blockno;
 			b->flags = 0;
-			b->refcnt = 1;
+			__sync_synchronize();
+			b->seq++;
 			release(&bcache.lock);
 			acquiresleep(&b->lock);
 			return b;
@@ -125,8 +173,7 @@ brelse(struct buf *b)
 	releasesleep(&b->lock);
 
 	acquire(&bcache.lock);
-	b->refcnt--;
-	if (b->refcnt == 0) {
+	if (__sync_sub_and_fetch(&b->refcnt, 1) == 0) {
 		// no one is waiting for it.
 		b->next->prev = b->prev;
 		b->prev->next = b->next;
@@ -0,0 +1,93 @@
+// Boot timing.
+//
+// main() and forkret() stamp the TSC as each step of startup
+// finishes, and init stamps its first start of the shell, so
+// that the bootstat tool can show where boot time goes.  The
+// first stamp is the one bootmain() left at BOOTTSC.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "x86.h"
+#include "bootstat.h"
+
+static struct {
+	struct bootstamp s[NBOOTSTAMP];
+	int next;  // Slots claimed
+	int n;     // Slots filled in, which BS_READ may copy
+} boot;
+
+// Claim a slot and fill it in, then publish the slots in order,
+// so that BS_READ never copies one half written.  Interrupts are
+// off meanwhile, so a later claimer only ever waits for another
+// CPU that is already filling in its slot.  Not pushcli(), which
+// needs %gs, as bootstatinit() runs before seginit().
+static void
+stamp(char *name, uint64 tsc)
+{
+	struct bootstamp *s;
+	uint eflags;
+	int i;
+
+	eflags = readeflags();
+	cli();
+	if((i = __sync_fetch_and_add(&boot.next, 1)) < NBOOTSTAMP){
+		s = &boot.s[i];
+		s->tsc = tsc;
+		safestrcpy(s->name, name, sizeof(s->name));
+		while(boot.n != i)
+			;
+		__sync_synchronize();
+		boot.n = i + 1;
+	}
+	if(eflags & FL_IF)
+		sti();
+}
+
+// Called first thing in main(), still on entrypgdir.  A loader
+// other than bootmain() may have left anything at BOOTTSC.
+void
+bootstatinit(void)
+{
+	uint64 *t = P2V(BOOTTSC);
+	uint64 now;
+
+	now = rdtsc();
+	if(*t && *t < now)
+		stamp("bootmain", *t);
+	stamp("main", now);
+}
+
+void
+bootstamp(char *name)
+{
+	stamp(name, rdtsc());
+}
+
+// Stamp the time under bs->name, or copy up to n stamps to bs.
+// Returns the number of stamps copied.  Only init may stamp, so
+// that other processes cannot use up the slots.
+int
+bootstatctl(int cmd, struct bootstamp *bs, int n)
+{
+	char name[sizeof(bs->name)];
+
+	switch(cmd){
+	case BS_MARK:
+		if(n < 1 || myproc()->pid != 1)
+			return -1;
+		safestrcpy(name, bs->name, sizeof(name));
+		bootstamp(name);
+		return 0;
+	case BS_READ:
+		if(n > boot.n)
+			n = boot.n;
+		__sync_synchronize();
+		memmove(bs, boot.s, n * sizeof(*bs));
+		return n;
+	}
+	return -1;
+}
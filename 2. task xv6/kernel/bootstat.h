@@ -0,0 +1,10 @@
+#define BS_MARK 1  // Stamp the time, under the name in the first entry
+#define BS_READ 2  // Copy the stamps out
+
+#define NBOOTSTAMP 32
+
+// The TSC when one step of boot finished, as read by bootstat().
+struct bootstamp {
+	char name[12];
+	uint64 tsc;
+};
@@ -4,6 +4,7 @@ struct buf {
 	uint blockno;
 	struct sleeplock lock;
 	uint refcnt;
+	volatile uint seq; // Odd while being recycled (see bfind)
 	struct buf *prev; // LRU cache list
 	struct buf *next;
 	struct buf *qnext; // disk queue
@@ -0,0 +1,112 @@
+// TSC clock.
+//
+// At boot, count TSC ticks across a known interval of the PIT
+// to find the TSC frequency, and read the RTC for the date.
+// The results go on a page that exec() maps read-only into every
+// process at TIMEVA (see clock.h); the kernel reads the same page.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "date.h"
+#include "clock.h"
+
+#define PIT_HZ    1193182  // 8254 input clock
+#define PIT_CH2   0x42
+#define PIT_CMD   0x43
+#define PIT_GATE  0x61     // Channel 2 gate (bit 0) and output (bit 5)
+#define CALMS     10       // Calibration interval, ms
+
+static struct timepage *tp;
+
+// Return the TSC frequency, timed against PIT channel 2
+// counting down once in mode 0.
+static uint
+tschz(void)
+{
+	uint count = PIT_HZ / (1000 / CALMS);
+	uint64 t0, t1;
+
+	outb(PIT_GATE, (inb(PIT_GATE) & ~0x02) | 0x01);  // gate on, speaker off
+	outb(PIT_CMD, 0xb0);  // channel 2, lo/hi byte, mode 0
+	outb(PIT_CH2, count & 0xff);
+	outb(PIT_CH2, count >> 8);
+	t0 = rdtsc();
+	while((inb(PIT_GATE) & 0x20) == 0)
+		;
+	t1 = rdtsc();
+	return (t1 - t0) * (1000 / CALMS);
+}
+
+// n / d, for a quotient that fits in 32 bits.
+static uint
+div6432(uint64 n, uint d)
+{
+	uint q, rem;
+
+	asm("divl %4" : "=a" (q), "=d" (rem) : "a" ((uint)n), "d" ((uint)(n >> 32)), "r" (d));
+	return q;
+}
+
+// Seconds since 1970 for an RTC date in 1970-2099.
+static uint
+epoch(struct rtcdate *d)
+{
+	static uint mdays[] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+	uint days;
+
+	days = (d->year - 1970) * 365 + (d->year - 1969) / 4 +
+	       mdays[d->month - 1] + d->day - 1;
+	if(d->month > 2 && d->year % 4 == 0)
+		days++;
+	return ((days*24 + d->hour)*60 + d->minute)*60 + d->second;
+}
+
+void
+clockinit(void)
+{
+	struct rtcdate d;
+	uint64 n;
+	uint hz;
+	int shift;
+
+	if((tp = (struct timepage*)kalloc()) == 0)
+		panic("clockinit");
+	memset(tp, 0, PGSIZE);
+	if((hz = tschz()) == 0)
+		panic("clockinit: no tsc");
+	cmostime(&d);
+	tp->tsc0 = rdtsc();
+	tp->boottime = epoch(&d);
+	tp->tschz = hz;
+
+	// mult = 1e9 << shift / hz, with shift as large as it can
+	// be while mult still fits in 32 bits.
+	for(shift = 32; shift > 0; shift--){
+		n = (uint64)1000000000 << shift;
+		if((uint)(n >> 32) < hz)
+			break;
+	}
+	tp->mult = div6432(n, hz);
+	tp->shift = shift;
+	cprintf("clock: tsc %d kHz\n", hz / 1000);
+}
+
+// Map the time page into pgdir, read-only.
+int
+maptimepage(pde_t *pgdir)
+{
+	return mapupage(pgdir, TIMEVA, (char*)tp, PTE_NOFREE);
+}
+
+int
+clockgettime(int clk, struct timespec *ts)
+{
+	if(clk != CLOCK_REALTIME && clk != CLOCK_MONOTONIC)
+		return -1;
+	clockread(tp, clk, ts);
+	return 0;
+}
@@ -0,0 +1,39 @@
+#define CLOCK_REALTIME  0  // Seconds since 1970, UTC
+#define CLOCK_MONOTONIC 1  // Since boot
+
+struct timespec {
+	uint sec;
+	uint nsec;
+};
+
+// Clock parameters, on a read-only page that every process has
+// mapped at TIMEVA, so user code can tell the time with
+// clockread() instead of a system call.
+struct timepage {
+	uint64 tsc0;     // TSC at boot
+	uint mult;       // Nanoseconds since boot are
+	uint shift;      //   (tsc - tsc0) * mult >> shift
+	uint boottime;   // Seconds since 1970 at boot
+	uint tschz;      // TSC ticks per second
+};
+
+// Read clock clk using the parameters in tp.  The TSC delta is
+// multiplied in two halves so that the product cannot overflow,
+// and nothing needs 64-bit division, which xv6 has no library for.
+static inline void
+clockread(struct timepage *tp, int clk, struct timespec *ts)
+{
+	uint64 t, ns;
+	uint hi, lo;
+
+	asm volatile("rdtsc" : "=A" (t));
+	t -= tp->tsc0;
+	hi = t >> 32;
+	lo = t;
+	ns = ((uint64)hi * tp->mult << (32 - tp->shift)) +
+	     ((uint64)lo * tp->mult >> tp->shift);
+	asm("divl %4" : "=a" (ts->sec), "=d" (ts->nsec)
+	              : "a" ((uint)ns), "d" ((uint)(ns >> 32)), "r" (1000000000));
+	if(clk == CLOCK_REALTIME)
+		ts->sec += tp->boottime;
+}
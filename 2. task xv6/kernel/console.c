@@ -14,6 +14,7 @@
 #include "mmu.h"
 #include "proc.h"
 #include "x86.h"
+#include "work.h"
 
 int echo = 1;
 
@@ -191,9 +192,19 @@ struct {
 	uint e;  // Edit index
 } input;
 
+// Characters taken from the keyboard and serial port by their
+// interrupt handlers, waiting for the worker to run consolework().
+struct {
+	struct spinlock lock;
+	uchar buf[INPUT_BUF];
+	uint r;  // Read index
+	uint w;  // Write index
+	struct work work;
+} rawin;
+
 #define C(x)  ((x)-'@')  // Control-x
 
-void
+static void
 consoleintr(int (*getc)(void))
 {
 	int c, doprocdump = 0;
@@ -237,6 +248,41 @@ consoleintr(int (*getc)(void))
 	}
 }
 
+// Called by the keyboard and serial interrupt handlers: drain
+// the device into rawin and leave the editing and echo to the
+// worker thread.
+void
+consoleirq(int (*getc)(void))
+{
+	int c;
+
+	acquire(&rawin.lock);
+	while((c = getc()) >= 0)
+		if(rawin.w - rawin.r < INPUT_BUF)
+			rawin.buf[rawin.w++ % INPUT_BUF] = c;
+	release(&rawin.lock);
+	queuework(&rawin.work);
+}
+
+static int
+rawgetc(void)
+{
+	int c;
+
+	acquire(&rawin.lock);
+	c = -1;
+	if(rawin.r != rawin.w)
+		c = rawin.buf[rawin.r++ % INPUT_BUF];
+	release(&rawin.lock);
+	return c;
+}
+
+static void
+consolework(void)
+{
+	consoleintr(rawgetc);
+}
+
 int
 consoleread(struct inode *ip, char *dst, int n)
 {
@@ -250,7 +296,7 @@ consoleread(struct inode *ip, char *dst, int n)
 		while(input.r == input.w){
 			if(myproc()->killed){
 				release(&cons.lock);
-				ilock(ip);
+				ilockshared(ip);
 				return -1;
 			}
 			sleep(&input.r, &cons.lock);
@@ -270,7 +316,7 @@ consoleread(struct inode *ip, char *dst, int n)
 			break;
 	}
 	release(&cons.lock);
-	ilock(ip);
+	ilockshared(ip);
 
 	return target - n;
 }
@@ -294,6 +340,8 @@ void
 consoleinit(void)
 {
 	initlock(&cons.lock, "console");
+	initlock(&rawin.lock, "rawin");
+	initwork(&rawin.work, consolework);
 
 	devsw[CONSOLE].write = consolewrite;
 	devsw[CONSOLE].read = consoleread;
@@ -1,14 +1,30 @@
+struct bootstamp;
 struct buf;
 struct context;
 struct file;
 struct inode;
+struct irqstat;
+struct lockstat;
 struct pipe;
 struct proc;
+struct rcuhead;
 struct rtcdate;
 struct spinlock;
 struct sleeplock;
 struct stat;
 struct superblock;
+struct sysstat;
+struct timespec;
+struct tunable;
+struct work;
+
+// acpi.c
+int             acpiinit(void);
+
+// bootstat.c
+void            bootstatinit(void);
+void            bootstamp(char*);
+int             bootstatctl(int, struct bootstamp*, int);
 
 // bio.c
 void            binit(void);
@@ -16,14 +32,21 @@ struct buf*     bread(uint, uint);
 void            brelse(struct buf*);
 void            bwrite(struct buf*);
 
+// clock.c
+int             clockgettime(int, struct timespec*);
+void            clockinit(void);
+int             maptimepage(pde_t*);
+
 // console.c
 void            consoleinit(void);
 void            cprintf(char*, ...);
-void            consoleintr(int(*)(void));
+void            consoleirq(int(*)(void));
 void            panic(char*) __attribute__((noreturn));
 
 // exec.c
 int             exec(char*, char**);
+pde_t*          loadimage(char*, char**, uint*, uint*, uint*);
+void            setprocname(struct proc*, char*);
 
 // file.c
 struct file*    filealloc(void);
@@ -31,6 +54,8 @@ void            fileclose(struct file*);
 struct file*    filedup(struct file*);
 void            fileinit(void);
 int             fileread(struct file*, char*, int n);
+int             filepread(struct file*, char*, int n, uint off);
+int             filepwrite(struct file*, char*, int n, uint off);
 int             filestat(struct file*, struct stat*);
 int             filewrite(struct file*, char*, int n);
 
@@ -42,6 +67,7 @@ struct inode*   ialloc(uint, short);
 struct inode*   idup(struct inode*);
 void            iinit(int dev);
 void            ilock(struct inode*);
+void            ilockshared(struct inode*);
 void            iput(struct inode*);
 void            iunlock(struct inode*);
 void            iunlockput(struct inode*);
@@ -60,14 +86,20 @@ void            iderw(struct buf*);
 
 // ioapic.c
 void            ioapicenable(int irq, int cpu);
+int             ioapicroute(int irq, int cpu);
+void            irqcount(int);
+int             irqstat(struct irqstat*, int);
 extern uchar    ioapicid;
 void            ioapicinit(void);
 
 // kalloc.c
 char*           kalloc(void);
 void            kfree(char*);
+char*           kallocn(int);
+void            kfreen(char*, int);
 void            kinit1(void*, void*);
 void            kinit2(void*, void*);
+int             kfreepages(void);
 
 // kbd.c
 void            kbdintr(void);
@@ -78,7 +110,9 @@ int             lapicid(void);
 extern volatile uint*    lapic;
 void            lapiceoi(void);
 void            lapicinit(void);
-void            lapicstartap(uchar, uint);
+void            lapicipi(int, int);
+void            lapicstartaps(uint);
+int             lapicx2apic(void);
 void            microdelay(int);
 
 // log.c
@@ -89,8 +123,14 @@ void            end_op();
 
 // mp.c
 extern int      ismp;
+void            mpaddcpu(uint);
 void            mpinit(void);
 
+// multiboot.c
+extern char     bootargs[];
+int             mbram(int, uint*, uint*);
+void            mbinit(void);
+
 // picirq.c
 void            picenable(int);
 void            picinit(void);
@@ -102,24 +142,46 @@ int             piperead(struct pipe*, char*, int);
 int             pipewrite(struct pipe*, char*, int);
 
 // proc.c
+extern int      maxproc;
+int             clone(void(*)(void*), void*, char*);
 int             cpuid(void);
 void            exit(void);
 int             fork(void);
+int             futexwait(int*, int);
+int             futexwake(int*, int);
 int             growproc(int);
+int             join(char**);
 int             kill(int);
-struct cpu*     mycpu(void);
-struct proc*    myproc();
+int             kthread(char*, void(*)(void*), void*);
+void            killthreads(struct proc*);
 void            pinit(void);
 void            procdump(void);
 void            scheduler(void) __attribute__((noreturn));
 void            sched(void);
 void            setproc(struct proc*);
+int             spawn(char*, char**, int*);
 void            sleep(void*, struct spinlock*);
 void            userinit(void);
+void            vmhold(void);
+void            vmrelease(void);
 int             wait(void);
 void            wakeup(void*);
+void            wakeupproc(struct proc*, void*);
 void            yield(void);
 
+// rcu.c
+void            rcubegin(void);
+void            rcuend(void);
+void            rcufree(struct rcuhead*, void(*)(struct rcuhead*));
+void            rcuinit(void);
+void            rcupoll(void);
+
+// ring.c
+int             ringenter(int, int);
+void            ringdrain(struct proc*);
+void            ringinit(void);
+int             ringsetup(void);
+
 // swtch.S
 void            swtch(struct context**, struct context*);
 
@@ -131,9 +193,15 @@ void            initlock(struct spinlock*, char*);
 void            release(struct spinlock*);
 void            pushcli(void);
 void            popcli(void);
+extern int      lockstaton;
+int             lockstatslot(char*);
+void            lockstatacquired(int, int, uint64);
+void            lockstatreleased(int, uint64);
+int             lockstatctl(int, struct lockstat*, int);
 
 // sleeplock.c
 void            acquiresleep(struct sleeplock*);
+void            acquiresleepshared(struct sleeplock*);
 void            releasesleep(struct sleeplock*);
 int             holdingsleep(struct sleeplock*);
 void            initsleeplock(struct sleeplock*, char*);
@@ -148,12 +216,23 @@ int             strncmp(const char*, const char*, uint);
 char*           strncpy(char*, const char*, int);
 
 // syscall.c
+int             argarray(int, char**, int, int);
 int             argint(int, int*);
 int             argptr(int, char**, int);
 int             argstr(int, char**);
 int             fetchint(uint, int*);
 int             fetchstr(uint, char**);
 void            syscall(void);
+int             sysstatctl(int, struct sysstat*, int);
+
+// tune.c
+extern int      logsize;
+extern int      maxopblocks;
+extern int      nbuf;
+extern int      nfile;
+extern int      ninode;
+void            tuneinit(void);
+int             tunectl(int, struct tunable*, int);
 
 // timer.c
 void            timerinit(void);
@@ -172,18 +251,28 @@ void            uartputc(int);
 // vm.c
 void            seginit(void);
 void            kvmalloc(void);
+void*           kmapphys(uint, uint);
 pde_t*          setupkvm(void);
 char*           uva2ka(pde_t*, char*);
 int             allocuvm(pde_t*, uint, uint);
 int             deallocuvm(pde_t*, uint, uint);
+int             deallocuvmsync(pde_t*, uint, uint);
 void            freevm(pde_t*);
 void            inituvm(pde_t*, char*, uint);
 int             loaduvm(pde_t*, char*, struct inode*, uint, uint);
 pde_t*          copyuvm(pde_t*, uint);
 void            switchuvm(struct proc*);
 void            switchkvm(void);
+void            tlbshootdown(pde_t*);
 int             copyout(pde_t*, uint, void*, uint);
 void            clearpteu(pde_t *pgdir, char *uva);
+int             mapupage(pde_t*, uint, char*, int);
+
+// work.c
+void            initwork(struct work*, void(*)(void));
+void            queuework(struct work*);
+void            workinit(void);
+void            workstart(void);
 
 // number of elements in fixed-size array
 #define NELEM(x) (sizeof(x)/sizeof((x)[0]))
@@ -7,26 +7,30 @@
 #include "x86.h"
 #include "elf.h"
 
-int
-exec(char *path, char **argv)
+// Build a fresh address space holding the program at path,
+// with argv laid out on its stack as main() expects.
+// Return the new page directory and store the image size,
+// entry point and initial stack pointer, or return 0.
+// Used by exec() and by spawn(), which builds a child
+// this way without copying the parent.
+pde_t*
+loadimage(char *path, char **argv, uint *szp, uint *entryp, uint *spp)
 {
-	char *s, *last;
 	int i, off;
 	uint argc, sz, sp, ustack[3+MAXARG+1];
 	struct elfhdr elf;
 	struct inode *ip;
 	struct proghdr ph;
-	pde_t *pgdir, *oldpgdir;
-	struct proc *curproc = myproc();
+	pde_t *pgdir;
 
 	begin_op();
 
 	if((ip = namei(path)) == 0){
 		end_op();
 		cprintf("exec: fail\n");
-		return -1;
+		return 0;
 	}
-	ilock(ip);
+	ilockshared(ip);
 	pgdir = 0;
 
 	// Check ELF header
@@ -35,7 +39,7 @@ exec(char *path, char **argv)
 	if(elf.magic != ELF_MAGIC)
 		goto bad;
 
-	if((pgdir = setupkvm()) == 0)
+	if((pgdir = setupkvm()) == 0 || maptimepage(pgdir) < 0)
 		goto bad;
 
 	// Load program into memory.
@@ -87,28 +91,60 @@ exec(char *path, char **argv)
 	if(copyout(pgdir, sp, ustack, (3+argc+1)*4) < 0)
 		goto bad;
 
-	// Save program name for debugging.
+	*szp = sz;
+	*entryp = elf.entry;
+	*spp = sp;
+	return pgdir;
+
+	bad:
+	if(pgdir)
+		freevm(pgdir);
+	if(ip){
+		iunlockput(ip);
+		end_op();
+	}
+	return 0;
+}
+
+// Save the last element of path in p->name for debugging.
+void
+setprocname(struct proc *p, char *path)
+{
+	char *s, *last;
+
 	for(last=s=path; *s; s++)
 		if(*s == '/')
 			last = s+1;
-	safestrcpy(curproc->name, last, sizeof(curproc->name));
+	safestrcpy(p->name, last, sizeof(p->name));
+}
+
+int
+exec(char *path, char **argv)
+{
+	uint sz, entry, sp;
+	pde_t *pgdir, *oldpgdir;
+	struct proc *curproc = myproc();
+
+	// Only the leader may replace the group's image.
+	if(curproc->leader != curproc)
+		return -1;
+
+	if((pgdir = loadimage(path, argv, &sz, &entry, &sp)) == 0)
+		return -1;
+	setprocname(curproc, path);
 
 	// Commit to the user image.
+	if(curproc->nthreads > 1)
+		killthreads(curproc);
+	ringdrain(curproc);
+	curproc->ring = 0;  // Freed with oldpgdir
 	oldpgdir = curproc->pgdir;
 	curproc->pgdir = pgdir;
 	curproc->sz = sz;
-	curproc->tf->eip = elf.entry;  // main
+	curproc->vmtop = 0;
+	curproc->tf->eip = entry;  // main
 	curproc->tf->esp = sp;
 	switchuvm(curproc);
 	freevm(oldpgdir);
 	return 0;
-
-	bad:
-	if(pgdir)
-		freevm(pgdir);
-	if(ip){
-		iunlockput(ip);
-		end_op();
-	}
-	return -1;
 }
@@ -5,21 +5,32 @@
 #include "types.h"
 #include "defs.h"
 #include "param.h"
+#include "mmu.h"
 #include "fs.h"
 #include "spinlock.h"
 #include "sleeplock.h"
 #include "file.h"
+#include "stat.h"
 
 struct devsw devsw[NDEV];
 struct {
 	struct spinlock lock;
-	struct file file[NFILE];
+	struct file *file;  // nfile of them, from kallocn
 } ftable;
 
 void
 fileinit(void)
 {
+	struct file *f;
+	int n;
+
 	initlock(&ftable.lock, "ftable");
+	n = PGROUNDUP(nfile * sizeof(struct file)) / PGSIZE;
+	if((ftable.file = (struct file*)kallocn(n)) == 0)
+		panic("fileinit: no memory");
+	memset(ftable.file, 0, n * PGSIZE);
+	for(f = ftable.file; f < ftable.file + nfile; f++)
+		initsleeplock(&f->offlock, "file offset");
 }
 
 // Allocate a file structure.
@@ -29,7 +40,7 @@ filealloc(void)
 	struct file *f;
 
 	acquire(&ftable.lock);
-	for(f = ftable.file; f < ftable.file + NFILE; f++){
+	for(f = ftable.file; f < ftable.file + nfile; f++){
 		if(f->ref == 0){
 			f->ref = 1;
 			release(&ftable.lock);
@@ -84,7 +95,7 @@ int
 filestat(struct file *f, struct stat *st)
 {
 	if(f->type == FD_INODE){
-		ilock(f->ip);
+		ilockshared(f->ip);
 		stati(f->ip, st);
 		iunlock(f->ip);
 		return 0;
@@ -103,9 +114,19 @@ fileread(struct file *f, char *addr, int n)
 	if(f->type == FD_PIPE)
 		return piperead(f->pipe, addr, n);
 	if(f->type == FD_INODE){
-		ilock(f->ip);
-		if((r = readi(f->ip, addr, f->off, n)) > 0)
-			f->off += r;
+		// Readers share the inode lock, so readers of this one
+		// file also need offlock to advance f->off in turn.
+		// Writers hold the inode exclusively and need no more.
+		// Devices use no offset and may block for a long time.
+		ilockshared(f->ip);
+		if(f->ip->type == T_DEV){
+			r = readi(f->ip, addr, f->off, n);
+		} else {
+			acquiresleep(&f->offlock);
+			if((r = readi(f->ip, addr, f->off, n)) > 0)
+				f->off += r;
+			releasesleep(&f->offlock);
+		}
 		iunlock(f->ip);
 		return r;
 	}
@@ -129,7 +150,7 @@ filewrite(struct file *f, char *addr, int n)
 		// and 2 blocks of slop for non-aligned writes.
 		// this really belongs lower down, since writei()
 		// might be writing a device like the console.
-		int max = ((MAXOPBLOCKS-1-1-2) / 2) * 512;
+		int max = ((maxopblocks-1-1-2) / 2) * 512;
 		int i = 0;
 		while(i < n){
 			int n1 = n - i;
@@ -154,3 +175,41 @@ filewrite(struct file *f, char *addr, int n)
 	panic("filewrite");
 }
 
+// Read from inode file f at off, leaving f->off alone.
+int
+filepread(struct file *f, char *addr, int n, uint off)
+{
+	int r;
+
+	if(f->readable == 0 || f->type != FD_INODE)
+		return -1;
+	ilockshared(f->ip);
+	r = readi(f->ip, addr, off, n);
+	iunlock(f->ip);
+	return r;
+}
+
+// Write to inode file f at off, leaving f->off alone.
+int
+filepwrite(struct file *f, char *addr, int n, uint off)
+{
+	int r, i, n1;
+	int max = ((maxopblocks-1-1-2) / 2) * 512;  // as in filewrite
+
+	if(f->writable == 0 || f->type != FD_INODE)
+		return -1;
+	for(i = 0; i < n; i += r){
+		n1 = n - i;
+		if(n1 > max)
+			n1 = max;
+		begin_op();
+		ilock(f->ip);
+		r = writei(f->ip, addr + i, off + i, n1);
+		iunlock(f->ip);
+		end_op();
+		if(r != n1)
+			break;
+	}
+	return i == n ? n : -1;
+}
+
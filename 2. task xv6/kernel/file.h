@@ -6,6 +6,7 @@ struct file {
 	struct pipe *pipe;
 	struct inode *ip;
 	uint off;
+	struct sleeplock offlock; // serializes readers' updates of off
 };
 
 
@@ -134,7 +134,9 @@ bfree(int dev, uint b)
 //
 // * Locked: file system code may only examine and modify
 //   the information in an inode and its content if it
-//   has first locked the inode.
+//   has first locked the inode.  Code that only examines
+//   may lock it shared with ilockshared(), so that many
+//   readers of one file (or directory) proceed in parallel.
 //
 // Thus a typical sequence is:
 //   ip = iget(dev, inum)
@@ -157,7 +159,11 @@ bfree(int dev, uint b)
 // The icache.lock spin-lock protects the allocation of icache
 // entries. Since ip->ref indicates whether an entry is free,
 // and ip->dev and ip->inum indicate which i-node an entry
-// holds, one must hold icache.lock while using any of those fields.
+// holds, one must hold icache.lock while using any of those fields,
+// with one exception: iget() first looks for a cached entry without
+// the lock.  Entries are never freed and ref only changes by atomic
+// instructions, so a lockless hit pins the entry by raising a
+// non-zero ref and then checks that it still holds the same inode.
 //
 // An ip->lock sleep-lock protects all ip-> fields other than ref,
 // dev, and inum.  One must hold ip->lock in order to
@@ -165,16 +171,21 @@ bfree(int dev, uint b)
 
 struct {
 	struct spinlock lock;
-	struct inode inode[NINODE];
+	struct inode *inode;  // ninode of them, from kallocn
 } icache;
 
 void
 iinit(int dev)
 {
 	int i = 0;
+	int n;
 
 	initlock(&icache.lock, "icache");
-	for(i = 0; i < NINODE; i++) {
+	n = PGROUNDUP(ninode * sizeof(struct inode)) / PGSIZE;
+	if((icache.inode = (struct inode*)kallocn(n)) == 0)
+		panic("iinit: no memory");
+	memset(icache.inode, 0, n * PGSIZE);
+	for(i = 0; i < ninode; i++) {
 		initsleeplock(&icache.inode[i].lock, "inode");
 	}
 
@@ -186,6 +197,8 @@ iinit(int dev)
 }
 
 static struct inode* iget(uint dev, uint inum);
+static struct inode* igetfast(uint dev, uint inum);
+static void iunpin(struct inode *ip);
 
 // Allocate an inode on device dev.
 // Mark it as allocated by  giving it type type.
@@ -242,13 +255,16 @@ iget(uint dev, uint inum)
 {
 	struct inode *ip, *empty;
 
+	if((ip = igetfast(dev, inum)) != 0)
+		return ip;
+
 	acquire(&icache.lock);
 
 	// Is the inode already cached?
 	empty = 0;
-	for(ip = &icache.inode[0]; ip < &icache.inode[NINODE]; ip++){
+	for(ip = &icache.inode[0]; ip < &icache.inode[ninode]; ip++){
 		if(ip->ref > 0 && ip->dev == dev && ip->inum == inum){
-			ip->ref++;
+			__sync_fetch_and_add(&ip->ref, 1);
 			release(&icache.lock);
 			return ip;
 		}
@@ -263,20 +279,62 @@ iget(uint dev, uint inum)
 	ip = empty;
 	ip->dev = dev;
 	ip->inum = inum;
-	ip->ref = 1;
 	ip->valid = 0;
+	__sync_synchronize();  // New identity before igetfast() can pin it
+	ip->ref = 1;
 	release(&icache.lock);
 
 	return ip;
 }
 
+// Find a cached entry for the inode without icache.lock and pin
+// it, or return 0.  An entry whose ref is zero may be recycled at
+// any moment, so it is left for iget() to take under the lock.
+static struct inode*
+igetfast(uint dev, uint inum)
+{
+	struct inode *ip;
+	int ref;
+
+	for(ip = &icache.inode[0]; ip < &icache.inode[ninode]; ip++){
+		if(ip->dev != dev || ip->inum != inum)
+			continue;
+		do {
+			if((ref = ip->ref) == 0)
+				return 0;
+		} while(!__sync_bool_compare_and_swap(&ip->ref, ref, ref+1));
+		if(ip->dev == dev && ip->inum == inum)
+			return ip;
+		// Recycled between the check and the pin.
+		iunpin(ip);
+		return 0;
+	}
+	return 0;
+}
+
+// Drop a reference taken by igetfast() on an entry that turned
+// out to hold another inode.  Only the last reference needs the
+// full iput(), which then cannot block on ip->lock.
+static void
+iunpin(struct inode *ip)
+{
+	int ref;
+
+	do {
+		if((ref = ip->ref) == 1){
+			iput(ip);
+			return;
+		}
+	} while(!__sync_bool_compare_and_swap(&ip->ref, ref, ref-1));
+}
+
 // Increment reference count for ip.
 // Returns ip to enable ip = idup(ip1) idiom.
 struct inode*
 idup(struct inode *ip)
 {
 	acquire(&icache.lock);
-	ip->ref++;
+	__sync_fetch_and_add(&ip->ref, 1);
 	release(&icache.lock);
 	return ip;
 }
@@ -310,11 +368,29 @@ ilock(struct inode *ip)
 	}
 }
 
-// Unlock the given inode.
+// Lock the given inode shared, for reading only.
+// Loading it from disk is a write, so that is done exclusively.
+void
+ilockshared(struct inode *ip)
+{
+	if(ip == 0 || ip->ref < 1)
+		panic("ilockshared");
+
+	acquiresleepshared(&ip->lock);
+	while(ip->valid == 0){
+		releasesleep(&ip->lock);
+		ilock(ip);
+		releasesleep(&ip->lock);
+		acquiresleepshared(&ip->lock);
+	}
+}
+
+// Unlock the given inode, locked either way.
 void
 iunlock(struct inode *ip)
 {
-	if(ip == 0 || !holdingsleep(&ip->lock) || ip->ref < 1)
+	if(ip == 0 || ip->ref < 1 ||
+	   (!holdingsleep(&ip->lock) && ip->lock.readers == 0))
 		panic("iunlock");
 
 	releasesleep(&ip->lock);
@@ -346,7 +422,7 @@ iput(struct inode *ip)
 	releasesleep(&ip->lock);
 
 	acquire(&icache.lock);
-	ip->ref--;
+	__sync_fetch_and_sub(&ip->ref, 1);
 	release(&icache.lock);
 }
 
@@ -663,10 +739,10 @@ namex(char *path, int nameiparent, char *name)
 	if(*path == '/')
 		ip = iget(ROOTDEV, ROOTINO);
 	else
-		ip = idup(myproc()->cwd);
+		ip = idup(myproc()->leader->cwd);
 
 	while((path = skipelem(path, name)) != 0){
-		ilock(ip);
+		ilockshared(ip);
 		if(ip->type != T_DIR){
 			iunlockput(ip);
 			return 0;
@@ -21,6 +21,10 @@ struct superblock {
 	uint bmapstart;    // Block number of first free map block
 };
 
+// Most blocks a transaction can log: the log header block
+// holds a count and then their block numbers.
+#define LOGMAX (BSIZE/4 - 1)
+
 #define NDIRECT 11
 #define NINDIRECT (BSIZE / sizeof(uint))
 #define NDBINDIRECT (NINDIRECT * NINDIRECT)
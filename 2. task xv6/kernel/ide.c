@@ -12,6 +12,7 @@
 #include "sleeplock.h"
 #include "fs.h"
 #include "buf.h"
+#include "work.h"
 
 #define SECTOR_SIZE   512
 #define IDE_BSY       0x80
@@ -27,9 +28,15 @@
 // idequeue points to the buf now being read/written to the disk.
 // idequeue->qnext points to the next buf to be processed.
 // You must hold idelock while manipulating queue.
+//
+// The interrupt handler only acknowledges the disk and sets
+// ideirq; idework() then finishes the request in a worker thread.
 
 static struct spinlock idelock;
 static struct buf *idequeue;
+static int ideirq;             // Active request done; protected by idelock
+static struct work idework;
+static void idedone(void);
 
 static int havedisk1;
 static void idestart(struct buf*);
@@ -53,6 +60,7 @@ ideinit(void)
 	int i;
 
 	initlock(&idelock, "ide");
+	initwork(&idework, idedone);
 	ioapicenable(IRQ_IDE, ncpu - 1);
 	idewait(0);
 
@@ -102,22 +110,38 @@ idestart(struct buf *b)
 // Interrupt handler.
 void
 ideintr(void)
+{
+	inb(0x1f7);  // Reading the status deasserts the interrupt
+	acquire(&idelock);
+	ideirq = 1;
+	release(&idelock);
+	queuework(&idework);
+}
+
+// Finish the active request, from a worker thread.
+static void
+idedone(void)
 {
 	struct buf *b;
 
 	// First queued buffer is the active request.
 	acquire(&idelock);
-
-	if((b = idequeue) == 0){
+	if(!ideirq || (b = idequeue) == 0){
 		release(&idelock);
 		return;
 	}
-	idequeue = b->qnext;
+	ideirq = 0;
+	release(&idelock);
 
-	// Read data if needed.
+	// Read data if needed.  No lock is needed: b stays at the
+	// head of the queue, and iderw() only starts the disk when
+	// the queue is empty.
 	if(!(b->flags & B_DIRTY) && idewait(1) >= 0)
 		insl(0x1f0, b->data, BSIZE/4);
 
+	acquire(&idelock);
+	idequeue = b->qnext;
+
 	// Wake process waiting for this buf.
 	b->flags |= B_VALID;
 	b->flags &= ~B_DIRTY;
@@ -4,7 +4,13 @@
 
 #include "types.h"
 #include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
 #include "traps.h"
+#include "irq.h"
 
 #define IOAPIC  0xFEC00000   // Default physical address of IO APIC
 
@@ -24,6 +30,15 @@
 
 volatile struct ioapic *ioapic;
 
+// Where each line is routed.  A line routed IRQ_RR moves to the
+// next CPU after every interrupt; dest is where it goes now.
+// The lock also keeps reg/data register pairs together.
+static struct {
+	struct spinlock lock;
+	int route[NIRQ];
+	int dest[NIRQ];
+} irqs;
+
 // IO APIC MMIO structure: write reg, then read or write data.
 struct ioapic {
 	uint reg;
@@ -50,6 +65,10 @@ ioapicinit(void)
 {
 	int i, id, maxintr;
 
+	initlock(&irqs.lock, "ioapic");
+	for(i = 0; i < NIRQ; i++)
+		irqs.route[i] = IRQ_OFF;
+
 	ioapic = (volatile struct ioapic*)IOAPIC;
 	maxintr = (ioapicread(REG_VER) >> 16) & 0xFF;
 	id = ioapicread(REG_ID) >> 24;
@@ -64,12 +83,89 @@ ioapicinit(void)
 	}
 }
 
-void
-ioapicenable(int irq, int cpunum)
+// Send irq to cpus[cpunum].  Caller must hold irqs.lock.
+static void
+ioapicdest(int irq, int cpunum)
 {
+	uint apicid;
+
 	// Mark interrupt edge-triggered, active high,
-	// enabled, and routed to the given cpunum,
-	// which happens to be that cpu's APIC ID.
+	// enabled, and routed to that cpu's APIC ID.
+	// The destination field has 8 bits, so a CPU with a wider
+	// x2APIC ID cannot take interrupts; send them to cpu 0.
+	irqs.dest[irq] = cpunum;
+	if((apicid = cpus[cpunum].apicid) > 254)
+		apicid = cpus[0].apicid;
 	ioapicwrite(REG_TABLE+2*irq, T_IRQ0 + irq);
-	ioapicwrite(REG_TABLE+2*irq+1, cpunum << 24);
+	ioapicwrite(REG_TABLE+2*irq+1, apicid << 24);
+}
+
+// Called by a driver to turn on its interrupt.
+void
+ioapicenable(int irq, int cpunum)
+{
+	acquire(&irqs.lock);
+	irqs.route[irq] = cpunum;
+	ioapicdest(irq, cpunum);
+	release(&irqs.lock);
+}
+
+// Route an enabled irq to cpunum, or to every CPU in turn if
+// cpunum is IRQ_RR.  Return the old route, or -1 if irq is not
+// enabled or cpunum is out of range.
+int
+ioapicroute(int irq, int cpunum)
+{
+	int old;
+
+	if(irq < 0 || irq >= NIRQ || cpunum < IRQ_RR || cpunum >= ncpu)
+		return -1;
+	acquire(&irqs.lock);
+	if((old = irqs.route[irq]) == IRQ_OFF){
+		release(&irqs.lock);
+		return -1;
+	}
+	irqs.route[irq] = cpunum;
+	if(cpunum != IRQ_RR)
+		ioapicdest(irq, cpunum);
+	release(&irqs.lock);
+	return old;
+}
+
+// Count an interrupt taken by this CPU and, if its line is
+// routed round-robin, pass the line on to the next CPU.
+// Called from trap() with interrupts disabled.
+void
+irqcount(int irq)
+{
+	// Vectors no driver enabled, like the local APIC's timer and
+	// error interrupts, are not IO APIC lines.
+	if(irqs.route[irq] == IRQ_OFF)
+		return;
+	mycpu()->nintr[irq]++;
+	if(irqs.route[irq] != IRQ_RR)
+		return;
+	acquire(&irqs.lock);
+	if(irqs.route[irq] == IRQ_RR)
+		ioapicdest(irq, (irqs.dest[irq] + 1) % ncpu);
+	release(&irqs.lock);
+}
+
+// Copy the routes and per-CPU counts of the first n lines to st.
+// Return the number of lines copied.
+int
+irqstat(struct irqstat *st, int n)
+{
+	struct cpu *c;
+	int i;
+
+	if(n > NIRQ)
+		n = NIRQ;
+	for(i = 0; i < n; i++){
+		st[i].route = irqs.route[i];
+		memset(st[i].count, 0, sizeof(st[i].count));
+		for(c = cpus; c < cpus+ncpu; c++)
+			st[i].count[c-cpus] = c->nintr[i];
+	}
+	return n;
 }
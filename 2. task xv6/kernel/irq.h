@@ -0,0 +1,8 @@
+#define IRQ_OFF  -2  // Route: line not enabled by any driver
+#define IRQ_RR   -1  // Route: rotate among all CPUs
+
+// One interrupt line, as read by irqstat().
+struct irqstat {
+	int route;         // CPU the line is sent to, IRQ_RR or IRQ_OFF
+	uint count[NCPU];  // Interrupts taken by each CPU
+};
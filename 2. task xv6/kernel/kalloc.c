@@ -21,6 +21,7 @@ struct {
 	struct spinlock lock;
 	int use_lock;
 	struct run *freelist;
+	int nfree;  // Pages on freelist
 } kmem;
 
 // Initialization happens in two phases.
@@ -36,10 +37,24 @@ kinit1(void *vstart, void *vend)
 	freerange(vstart, vend);
 }
 
+// Free only what the boot loader's memory map says is RAM,
+// if it gave one.
 void
 kinit2(void *vstart, void *vend)
 {
-	freerange(vstart, vend);
+	uint start, end;
+	int i;
+
+	if(!mbram(0, &start, &end))
+		freerange(vstart, vend);
+	for(i = 0; mbram(i, &start, &end); i++){
+		if(start < V2P(vstart))
+			start = V2P(vstart);
+		if(end > V2P(vend))
+			end = V2P(vend);
+		if(start < end)
+			freerange(P2V(start), P2V(end));
+	}
 	kmem.use_lock = 1;
 }
 
@@ -72,6 +87,7 @@ kfree(char *v)
 	r = (struct run*)v;
 	r->next = kmem.freelist;
 	kmem.freelist = r;
+	kmem.nfree++;
 	if(kmem.use_lock)
 		release(&kmem.lock);
 }
@@ -87,10 +103,63 @@ kalloc(void)
 	if(kmem.use_lock)
 		acquire(&kmem.lock);
 	r = kmem.freelist;
-	if(r)
+	if(r){
 		kmem.freelist = r->next;
+		kmem.nfree--;
+	}
+	if(kmem.use_lock)
+		release(&kmem.lock);
+	return (char*)r;
+}
+
+// Allocate n physically contiguous pages, for tables sized at
+// run time, and return the lowest.  freerange() leaves the free
+// list in descending address order, so look for a run of n
+// pages that follow each other on it.  Returns 0 if there is
+// no such run.
+char*
+kallocn(int n)
+{
+	struct run **start, **pp, *r, *prev;
+	int len;
+
+	if(n == 1)
+		return kalloc();
+	if(kmem.use_lock)
+		acquire(&kmem.lock);
+	len = 0;
+	prev = 0;
+	start = &kmem.freelist;
+	for(pp = &kmem.freelist; (r = *pp) != 0; pp = &r->next){
+		if(len > 0 && (char*)r == (char*)prev - PGSIZE)
+			len++;
+		else {
+			len = 1;
+			start = pp;
+		}
+		prev = r;
+		if(len == n){
+			*start = r->next;
+			kmem.nfree -= n;
+			break;
+		}
+	}
 	if(kmem.use_lock)
 		release(&kmem.lock);
 	return (char*)r;
 }
 
+// Free n pages allocated by kallocn().
+void
+kfreen(char *v, int n)
+{
+	for(; n > 0; n--, v += PGSIZE)
+		kfree(v);
+}
+
+// Return the number of free pages.
+int
+kfreepages(void)
+{
+	return kmem.nfree;
+}
@@ -9,6 +9,7 @@
 #include "traps.h"
 #include "mmu.h"
 #include "x86.h"
+#include "proc.h"
 
 // Local APIC registers, divided by 4 for use as uint[] indices.
 #define ID      (0x0020/4)   // ID
@@ -41,21 +42,72 @@
 #define TCCR    (0x0390/4)   // Timer Current Count
 #define TDCR    (0x03E0/4)   // Timer Divide Configuration
 
+// In x2APIC mode the same registers are MSRs, at MSR_X2APIC plus
+// a sixteenth of the offset, and ICRLO and ICRHI are one MSR.
+#define MSR_APICBASE 0x1B      // APIC base address and mode
+	#define APICBASE_EXTD 0x400  // x2APIC mode
+	#define APICBASE_EN   0x800  // APIC enabled
+#define MSR_X2APIC   0x800
+
 volatile uint *lapic;  // Initialized in mp.c
+int x2apic;            // Using x2APIC mode?  See lapicx2apic()
+
+static uint
+lapicr(int index)
+{
+	if(x2apic)
+		return rdmsr(MSR_X2APIC + index/4);
+	return lapic[index];
+}
 
 static void
 lapicw(int index, int value)
 {
+	if(x2apic){
+		wrmsr(MSR_X2APIC + index/4, (uint)value);
+		return;
+	}
 	lapic[index] = value;
 	lapic[ID];  // wait for write to finish, by reading
 }
 
+// Send an interrupt command to the APIC with ID apicid.
+static void
+lapicicr(uint apicid, uint cmd)
+{
+	if(x2apic){
+		wrmsr(MSR_X2APIC + ICRLO/4, (uint64)apicid << 32 | cmd);
+		return;
+	}
+	lapicw(ICRHI, apicid<<24);
+	lapicw(ICRLO, cmd);
+	while(lapic[ICRLO] & DELIVS)
+		;
+}
+
+// Switch the local APICs to x2APIC mode, for APIC IDs too wide
+// for the 8-bit xAPIC ones.  Each CPU switches in lapicinit().
+// Returns 0 if the CPU has no x2APIC mode.
+int
+lapicx2apic(void)
+{
+	uint a, b, c, d;
+
+	cpuinfo(1, &a, &b, &c, &d);
+	if(c & CPUID_X2APIC)
+		x2apic = 1;
+	return x2apic;
+}
+
 void
 lapicinit(void)
 {
 	if(!lapic)
 		return;
 
+	if(x2apic)
+		wrmsr(MSR_APICBASE, rdmsr(MSR_APICBASE) | APICBASE_EN | APICBASE_EXTD);
+
 	// Enable local APIC; set spurious interrupt vector.
 	lapicw(SVR, ENABLE | (T_IRQ0 + IRQ_SPURIOUS));
 
@@ -73,7 +125,7 @@ lapicinit(void)
 
 	// Disable performance counter overflow interrupts
 	// on machines that provide that interrupt entry.
-	if(((lapic[VER]>>16) & 0xFF) >= 4)
+	if(((lapicr(VER)>>16) & 0xFF) >= 4)
 		lapicw(PCINT, MASKED);
 
 	// Map error interrupt to IRQ_ERROR.
@@ -87,10 +139,9 @@ lapicinit(void)
 	lapicw(EOI, 0);
 
 	// Send an Init Level De-Assert to synchronise arbitration ID's.
-	lapicw(ICRHI, 0);
-	lapicw(ICRLO, BCAST | INIT | LEVEL);
-	while(lapic[ICRLO] & DELIVS)
-		;
+	// x2APIC mode has no arbitration IDs, nor this command.
+	if(!x2apic)
+		lapicicr(0, BCAST | INIT | LEVEL);
 
 	// Enable interrupts on the APIC (but not on the processor).
 	lapicw(TPR, 0);
@@ -101,7 +152,9 @@ lapicid(void)
 {
 	if (!lapic)
 		return 0;
-	return lapic[ID] >> 24;
+	if(x2apic)
+		return lapicr(ID);
+	return lapicr(ID) >> 24;
 }
 
 // Acknowledge interrupt.
@@ -119,16 +172,27 @@ microdelay(int us)
 {
 }
 
+// Send an inter-processor interrupt with the given vector
+// to the CPU whose local APIC ID is apicid.
+void
+lapicipi(int apicid, int vector)
+{
+	lapicicr(apicid, FIXED | ASSERT | vector);
+}
+
 #define CMOS_PORT    0x70
 #define CMOS_RETURN  0x71
 
-// Start additional processor running entry code at addr.
-// See Appendix B of MultiProcessor Specification.
+// Start every other processor running entry code at addr.
+// See Appendix B of MultiProcessor Specification.  Each step
+// goes to all the APs before the delay that follows it, so
+// the delays are paid once rather than once per AP.
 void
-lapicstartap(uchar apicid, uint addr)
+lapicstartaps(uint addr)
 {
 	int i;
 	ushort *wrv;
+	struct cpu *c;
 
 	// "The BSP must initialize CMOS shutdown code to 0AH
 	// and the warm reset vector (DWORD based at 40:67) to point at
@@ -141,10 +205,14 @@ lapicstartap(uchar apicid, uint addr)
 
 	// "Universal startup algorithm."
 	// Send INIT (level-triggered) interrupt to reset other CPU.
-	lapicw(ICRHI, apicid<<24);
-	lapicw(ICRLO, INIT | LEVEL | ASSERT);
+	for(c = cpus; c < cpus+ncpu; c++)
+		if(c != mycpu())
+			lapicicr(c->apicid, INIT | LEVEL | ASSERT);
 	microdelay(200);
-	lapicw(ICRLO, INIT | LEVEL);
+	if(!x2apic)
+		for(c = cpus; c < cpus+ncpu; c++)
+			if(c != mycpu())
+				lapicicr(c->apicid, INIT | LEVEL);
 	microdelay(100);    // should be 10ms, but too slow in Bochs!
 
 	// Send startup IPI (twice!) to enter code.
@@ -153,8 +221,9 @@ lapicstartap(uchar apicid, uint addr)
 	// should be ignored, but it is part of the official Intel algorithm.
 	// Bochs complains about the second one.  Too bad for Bochs.
 	for(i = 0; i < 2; i++){
-		lapicw(ICRHI, apicid<<24);
-		lapicw(ICRLO, STARTUP | (addr>>12));
+		for(c = cpus; c < cpus+ncpu; c++)
+			if(c != mycpu())
+				lapicicr(c->apicid, STARTUP | (addr>>12));
 		microdelay(200);
 	}
 }
@@ -0,0 +1,12 @@
+#define LS_START 1  // Reset the counters and start recording
+#define LS_STOP  2  // Stop recording
+#define LS_READ  3  // Copy the counters out
+
+// Counters for all locks sharing a name, as read by lockstat().
+struct lockstat {
+	char name[16];
+	uint acquires;    // Times acquired
+	uint contended;   // Acquisitions that had to wait
+	uint waitkcycles; // Cycles spent waiting, in units of 1024
+	uint maxhold;     // Longest time held, in cycles
+};
@@ -33,7 +33,7 @@
 // and to keep track in memory of logged block# before commit.
 struct logheader {
 	int n;
-	int block[LOGSIZE];
+	int block[LOGMAX];
 };
 
 struct log {
@@ -53,7 +53,7 @@ static void commit();
 void
 initlog(int dev)
 {
-	if (sizeof(struct logheader) >= BSIZE)
+	if (sizeof(struct logheader) > BSIZE)
 		panic("initlog: too big logheader");
 
 	struct superblock sb;
@@ -62,6 +62,17 @@ initlog(int dev)
 	log.start = sb.logstart;
 	log.size = sb.nlog;
 	log.dev = dev;
+
+	// A transaction must fit in the log on disk, and the buffer
+	// cache must hold all of its blocks until it commits.
+	if(logsize == 0 || logsize > log.size - 1)
+		logsize = log.size - 1;
+	if(logsize > LOGMAX)
+		logsize = LOGMAX;
+	if(logsize > nbuf - 1)
+		logsize = nbuf - 1;
+	if(maxopblocks > logsize)
+		maxopblocks = logsize;
 	recover_from_log();
 }
 
@@ -129,7 +140,7 @@ begin_op(void)
 	while(1){
 		if(log.committing){
 			sleep(&log, &log.lock);
-		} else if(log.lh.n + (log.outstanding+1)*MAXOPBLOCKS > LOGSIZE){
+		} else if(log.lh.n + (log.outstanding+1)*maxopblocks > logsize){
 			// this op might exhaust log space; wait for commit.
 			sleep(&log, &log.lock);
 		} else {
@@ -215,7 +226,7 @@ log_write(struct buf *b)
 {
 	int i;
 
-	if (log.lh.n >= LOGSIZE || log.lh.n >= log.size - 1)
+	if (log.lh.n >= logsize || log.lh.n >= log.size - 1)
 		panic("too big a transaction");
 	if (log.outstanding < 1)
 		panic("log_write outside of trans");
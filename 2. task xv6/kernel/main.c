@@ -17,23 +17,39 @@ extern char end[]; // first address after kernel loaded from ELF file
 int
 main(void)
 {
+	mbinit();        // multiboot memory map and command line
+	bootstatinit();  // boot timing
+	tuneinit();      // table sizes from the command line
 	kinit1(end, P2V(4*1024*1024)); // phys page allocator
+	bootstamp("kinit1");
 	kvmalloc();      // kernel page table
+	bootstamp("kvmalloc");
 	mpinit();        // detect other processors
+	bootstamp("mpinit");
 	lapicinit();     // interrupt controller
 	seginit();       // segment descriptors
 	picinit();       // disable pic
 	ioapicinit();    // another interrupt controller
+	workinit();      // interrupt work queues, before any handler queues
 	consoleinit();   // console hardware
 	uartinit();      // serial port
 	pinit();         // process table
+	rcuinit();       // read-copy-update
 	tvinit();        // trap vectors
-	binit();         // buffer cache
-	fileinit();      // file table
 	ideinit();       // disk
+	bootstamp("ideinit");
+	clockinit();     // TSC clock
+	bootstamp("clockinit");
 	startothers();   // start other processors
+	bootstamp("startothers");
 	kinit2(P2V(4*1024*1024), P2V(PHYSTOP)); // must come after startothers()
+	bootstamp("kinit2");
+	binit();         // buffer cache, sized by nbuf
+	fileinit();      // file table, sized by nfile
 	userinit();      // first user process
+	bootstamp("userinit");
+	workstart();     // interrupt worker threads
+	ringinit();      // submission ring workers
 	mpmain();        // finish this processor's setup
 }
 
@@ -42,8 +58,8 @@ static void
 mpenter(void)
 {
 	switchkvm();
+	lapicinit();     // before seginit() reads the APIC ID in x2APIC mode
 	seginit();
-	lapicinit();
 	mpmain();
 }
 
@@ -59,14 +75,15 @@ mpmain(void)
 
 pde_t entrypgdir[];  // For entry.S
 
-// Start the non-boot (AP) processors.
+// Start the non-boot (AP) processors, all at once.
 static void
 startothers(void)
 {
 	extern uchar _binary_kernel_entryother_start[], _binary_kernel_entryother_size[];
 	uchar *code;
 	struct cpu *c;
-	char *stack;
+	char **stacks;
+	int n;
 
 	// Write entry code to unused memory at 0x7000.
 	// The linker has placed the image of entryother.S in
@@ -74,24 +91,31 @@ startothers(void)
 	code = P2V(0x7000);
 	memmove(code, _binary_kernel_entryother_start, (uint)_binary_kernel_entryother_size);
 
-	for(c = cpus; c < cpus+ncpu; c++){
-		if(c == mycpu())  // We've started already.
-			continue;
+	// Give each AP its own stack; entryother.S hands them out in
+	// whatever order the APs get there.
+	if(ncpu > PGSIZE/sizeof(*stacks) || (stacks = (char**)kalloc()) == 0)
+		panic("startothers");
+	for(n = 0; n < ncpu-1; n++){
+		if((stacks[n] = kalloc()) == 0)
+			panic("startothers: no stack");
+		stacks[n] += KSTACKSIZE;
+	}
 
-		// Tell entryother.S what stack to use, where to enter, and what
-		// pgdir to use. We cannot use kpgdir yet, because the AP processor
-		// is running in low  memory, so we use entrypgdir for the APs too.
-		stack = kalloc();
-		*(void**)(code-4) = stack + KSTACKSIZE;
-		*(void(**)(void))(code-8) = mpenter;
-		*(int**)(code-12) = (void *) V2P(entrypgdir);
+	// Tell entryother.S what stacks to use, where to enter, and what
+	// pgdir to use. We cannot use kpgdir yet, because the AP processor
+	// is running in low  memory, so we use entrypgdir for the APs too.
+	*(char***)(code-4) = stacks;
+	*(void(**)(void))(code-8) = mpenter;
+	*(int**)(code-12) = (void *) V2P(entrypgdir);
 
-		lapicstartap(c->apicid, V2P(code));
+	lapicstartaps(V2P(code));
 
-		// wait for cpu to finish mpmain()
-		while(c->started == 0)
+	// Wait for every other cpu to finish mpmain().  This one
+	// only sets started once startothers() returns.
+	for(c = cpus; c < cpus+ncpu; c++)
+		while(c != mycpu() && c->started == 0)
 			;
-	}
+	kfree((char*)stacks);
 }
 
 // The boot page table used in entry.S and entryother.S.
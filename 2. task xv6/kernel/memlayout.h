@@ -1,5 +1,6 @@
 // Memory layout
 
+#define BOOTTSC 0x500               // bootmain() leaves its TSC here (bootstat.c)
 #define EXTMEM  0x100000            // Start of extended memory
 #define PHYSTOP 0xE000000           // Top physical memory
 #define DEVSPACE 0xFE000000         // Other devices are at high addresses
@@ -7,6 +8,13 @@
 // Key addresses for address space layout (see kmap in vm.c for layout)
 #define KERNBASE 0x80000000         // First kernel virtual address
 #define KERNLINK (KERNBASE+EXTMEM)  // Address where kernel is linked
+#define KMAPBASE (KERNBASE+PHYSTOP) // Firmware tables above PHYSTOP (kmapphys)
+
+// User memory ends at USERTOP.  Above it the kernel may map
+// pages of its own into a process; the page table owns them.
+#define USERTOP  (KERNBASE-0x10000)
+#define RINGVA   (KERNBASE-0x1000)    // Submission/completion ring (ring.c)
+#define TIMEVA   (KERNBASE-0x2000)    // Clock parameters, read-only (clock.c)
 
 #define V2P(a) (((uint) (a)) - KERNBASE)
 #define P2V(a) ((void *)(((char *) (a)) + KERNBASE))
@@ -2,6 +2,7 @@
 // x86 memory management unit (MMU).
 
 // Eflags register
+#define FL_TF           0x00000100      // Trap Flag
 #define FL_IF           0x00000200      // Interrupt Enable
 
 // Control Register flags
@@ -10,6 +11,18 @@
 #define CR0_PG          0x80000000      // Paging
 
 #define CR4_PSE         0x00000010      // Page size extension
+#define CR4_PGE         0x00000080      // Page global enable
+
+// CPUID leaf 1 %edx feature bits
+#define CPUID_SEP       0x00000800      // SYSENTER/SYSEXIT
+
+// CPUID leaf 1 %ecx feature bits
+#define CPUID_X2APIC    0x00200000      // Local APIC has x2APIC mode
+
+// Model-specific registers
+#define MSR_SYSENTER_CS  0x174          // Kernel %cs; %ss is the next selector
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
 
 // various segment selectors.
 #define SEG_KCODE 1  // kernel code
@@ -17,9 +30,12 @@
 #define SEG_UCODE 3  // user code
 #define SEG_UDATA 4  // user data+stack
 #define SEG_TSS   5  // this process's task state
+#define SEG_KCPU  6  // kernel per-cpu data, loaded in %gs
 
 // cpu->gdt[NSEGS] holds the above segments.
-#define NSEGS     6
+#define NSEGS     7
+
+#define CACHELINE 64  // bytes per cache line
 
 #ifndef __ASSEMBLER__
 
@@ -103,6 +119,8 @@
 #define PTE_W           0x002   // Writeable
 #define PTE_U           0x004   // User
 #define PTE_PS          0x080   // Page Size
+#define PTE_G           0x100   // Global: kept across %cr3 loads
+#define PTE_NOFREE      0x200   // Shared kernel page; freevm() leaves it
 
 // Address in page table or page directory entry
 #define PTE_ADDR(pte)   ((uint)(pte) & ~0xFFF)
@@ -1,5 +1,6 @@
 // Multiprocessor support
-// Search memory for MP description structures.
+// Find the processors from the ACPI MADT (acpi.c) or, failing
+// that, by searching memory for MP description structures.
 // http://developer.intel.com/design/pentium/datashts/24201606.pdf
 
 #include "types.h"
@@ -11,10 +12,13 @@
 #include "mmu.h"
 #include "proc.h"
 
-struct cpu cpus[NCPU];
+struct cpu *cpus;
 int ncpu;
 uchar ioapicid;
 
+static uint apicids[NCPU];  // Found so far, before cpus exists
+static int nskipped;        // CPUs found but not usable
+
 static uchar
 sum(uchar *addr, int len)
 {
@@ -88,8 +92,27 @@ mpconfig(struct mp **pmp)
 	return conf;
 }
 
+// Register a processor found in the firmware tables.  APIC IDs
+// above 254 need the local APICs in x2APIC mode.
 void
-mpinit(void)
+mpaddcpu(uint apicid)
+{
+	int i;
+
+	for(i = 0; i < ncpu; i++)
+		if(apicids[i] == apicid)
+			return;
+	if(ncpu == NCPU || (apicid > 254 && !lapicx2apic())){
+		nskipped++;
+		return;
+	}
+	apicids[ncpu++] = apicid;  // apicid may differ from ncpu
+}
+
+// Register the processors and I/O APIC listed in the MP tables.
+// Returns -1 if there are no MP tables.
+static int
+mptables(void)
 {
 	uchar *p, *e;
 	int ismp;
@@ -99,17 +122,14 @@ mpinit(void)
 	struct mpioapic *ioapic;
 
 	if((conf = mpconfig(&mp)) == 0)
-		panic("Expect to run on an SMP");
+		return -1;
 	ismp = 1;
 	lapic = (uint*)conf->lapicaddr;
 	for(p=(uchar*)(conf+1), e=(uchar*)conf+conf->length; p<e; ){
 		switch(*p){
 		case MPPROC:
 			proc = (struct mpproc*)p;
-			if(ncpu < NCPU) {
-				cpus[ncpu].apicid = proc->apicid;  // apicid may differ from ncpu
-				ncpu++;
-			}
+			mpaddcpu(proc->apicid);
 			p += sizeof(struct mpproc);
 			continue;
 		case MPIOAPIC:
@@ -136,4 +156,24 @@ mpinit(void)
 		outb(0x22, 0x70);   // Select IMCR
 		outb(0x23, inb(0x23) | 1);  // Mask external interrupts.
 	}
+	return 0;
+}
+
+void
+mpinit(void)
+{
+	int i, n;
+
+	if(acpiinit() < 0 && mptables() < 0)
+		panic("Expect to run on an SMP");
+	if(nskipped)
+		cprintf("mpinit: ignored %d cpus; NCPU is %d\n", nskipped, NCPU);
+
+	// Size the per-CPU table to the CPUs found.
+	n = PGROUNDUP(ncpu * sizeof(struct cpu)) / PGSIZE;
+	if((cpus = (struct cpu*)kallocn(n)) == 0)
+		panic("mpinit: no memory for cpus");
+	memset(cpus, 0, n * PGSIZE);
+	for(i = 0; i < ncpu; i++)
+		cpus[i].apicid = apicids[i];
 }
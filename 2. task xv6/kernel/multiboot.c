@@ -0,0 +1,87 @@
+// Multiboot.
+//
+// A multiboot loader such as GRUB, or QEMU's -kernel, loads the
+// kernel ELF itself and enters at entry with MB_MAGIC in %eax and
+// its boot information in %ebx, which entry saves here.  mbinit()
+// keeps the memory map, so that kinit2() frees only real RAM, and
+// the command line.  Booted by bootmain() there is neither; all
+// memory up to PHYSTOP is assumed present, as before.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "multiboot.h"
+
+#define NRAM 16
+
+uint mbmagic;   // set by entry
+uint mbinfo;
+
+char bootargs[128];  // kernel command line, or ""
+
+static struct {
+	uint start, end;
+} ram[NRAM];
+static int nram;
+
+// Return a pointer to physical [pa, pa+n) if entrypgdir maps it.
+static void*
+lowmem(uint pa, uint n)
+{
+	if(pa == 0 || pa >= 4*1024*1024 || n > 4*1024*1024 - pa)
+		return 0;
+	return P2V(pa);
+}
+
+static void
+addram(uint64 start, uint64 end)
+{
+	if(start >= PHYSTOP || nram == NRAM)
+		return;
+	if(end > PHYSTOP)
+		end = PHYSTOP;
+	ram[nram].start = start;
+	ram[nram].end = end;
+	nram++;
+}
+
+// Called first thing in main(), still on entrypgdir, before
+// kinit1() can hand out the pages the loader left its data in.
+void
+mbinit(void)
+{
+	struct mbinfo *mb;
+	struct mbmmap *m;
+	char *p, *e;
+
+	if(mbmagic != MB_MAGIC || (mb = lowmem(mbinfo, sizeof(*mb))) == 0)
+		return;
+	// No bootmain() stamp; don't trust what is at BOOTTSC.
+	*(uint64*)P2V(BOOTTSC) = 0;
+
+	if((mb->flags & MBI_MMAP) && (p = lowmem(mb->mmap_addr, mb->mmap_length))){
+		e = p + mb->mmap_length;
+		for(; p + sizeof(*m) <= e; p += m->size + sizeof(m->size)){
+			m = (struct mbmmap*)p;
+			if(m->type == MBMEM_RAM)
+				addram(m->addr, m->addr + m->len);
+		}
+	} else if(mb->flags & MBI_MEM)
+		addram(0x100000, 0x100000 + (uint64)mb->mem_upper*1024);
+
+	if((mb->flags & MBI_CMDLINE) && (p = lowmem(mb->cmdline, sizeof(bootargs))))
+		safestrcpy(bootargs, p, sizeof(bootargs));
+}
+
+// Copy the i'th usable RAM range to *start and *end.
+// Returns 0 past the last one, or if the loader gave no map.
+int
+mbram(int i, uint *start, uint *end)
+{
+	if(i >= nram)
+		return 0;
+	*start = ram[i].start;
+	*end = ram[i].end;
+	return 1;
+}
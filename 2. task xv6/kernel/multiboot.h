@@ -0,0 +1,30 @@
+// See the Multiboot Specification, version 0.6.96.
+
+#define MB_MAGIC 0x2BADB002     // in %eax when a multiboot loader enters us
+
+// mbinfo.flags
+#define MBI_MEM      0x001      // mem_lower and mem_upper are valid
+#define MBI_CMDLINE  0x004      // cmdline is valid
+#define MBI_MMAP     0x040      // mmap_length and mmap_addr are valid
+
+struct mbinfo {         // boot information, at phys addr in %ebx
+	uint flags;
+	uint mem_lower;               // KB of memory below 1MB
+	uint mem_upper;               // KB of memory from 1MB to the first hole
+	uint boot_device;
+	uint cmdline;                 // phys addr of NUL-terminated string
+	uint mods_count;
+	uint mods_addr;
+	uint syms[4];
+	uint mmap_length;             // bytes of memory map
+	uint mmap_addr;               // phys addr of memory map
+};
+
+struct mbmmap {         // memory map entry
+	uint size;                    // bytes in the rest of this entry
+	uint64 addr;
+	uint64 len;
+	uint type;
+} __attribute__((packed));
+
+#define MBMEM_RAM 1             // mbmmap.type for usable RAM
@@ -1,14 +1,15 @@
-#define NPROC        64  // maximum number of processes
 #define KSTACKSIZE 4096  // size of per-process kernel stack
-#define NCPU          8  // maximum number of CPUs
+#define NCPU         64  // maximum number of CPUs
+#define NIRQ         24  // interrupt lines that can be routed and counted
 #define NOFILE       16  // open files per process
-#define NFILE       100  // open files per system
-#define NINODE       50  // maximum number of active i-nodes
+#define NSPAWNFD      3  // fds a spawn() remap table covers
+#define NFILE       100  // open files per system, unless nfile= at boot
+#define NINODE       50  // maximum number of active i-nodes, unless ninode=
 #define NDEV         10  // maximum major device number
 #define ROOTDEV       1  // device number of file system root disk
 #define MAXARG       32  // max exec arguments
-#define MAXOPBLOCKS  10  // max # of blocks any FS op writes
-#define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
-#define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
-#define FSSIZE       1000  // size of file system in blocks
+#define MAXOPBLOCKS  10  // max # of blocks any FS op writes, at least
+#define LOGSIZE      (MAXOPBLOCKS*3)  // data blocks in the log mkfs makes
+#define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache, at least
+#define FSSIZE       4000  // size of file system in blocks
 
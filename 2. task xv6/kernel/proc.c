@@ -7,66 +7,184 @@
 #include "proc.h"
 #include "spinlock.h"
 
+#define NPIDHASH  1024
+#define PROCPAGES 8     // Pages a small process needs, for sizing maxproc
+
+// Procs are carved out of kalloc'd pages on demand and never
+// given back; a dead proc goes on the free list for reuse.
 struct {
 	struct spinlock lock;
-	struct proc proc[NPROC];
+	struct proc *all;                // Every proc ever carved, via anext
+	int nproc;                       // Length of all
+	struct proc *free;               // UNUSED procs
+	struct proc *runq;               // RUNNABLE procs, oldest first
+	struct proc **runqtail;
+	struct proc *pidhash[NPIDHASH];  // Allocated procs by pid
 } ptable;
 
+int maxproc;  // Limit on ptable.nproc: the nproc tunable, or set by userinit()
+
 static struct proc *initproc;
 
 int nextpid = 1;
 extern void forkret(void);
 extern void trapret(void);
+static void kthreadret(void);
 
 static void wakeup1(void *chan);
 
-void
-pinit(void)
+// Process lists.  A proc is on at most one list at a time,
+// linked through lnext and lprev so that it can be unlinked
+// without a scan:
+//   ptable.free        UNUSED procs
+//   parent->children   live child processes
+//   parent->zombies    exited child processes awaiting wait()
+//   leader->threads    the group's other threads, live or exited
+// EMBRYOs and initproc are on no list.  Allocated procs are
+// also chained by pid in ptable.pidhash.  All of this is
+// protected by ptable.lock, except that pidlookup() walks the
+// pid hash locklessly under rcubegin(); so a freed proc keeps
+// its hnext and is not reused until an RCU grace period has
+// passed (see freeproc).
+
+static void
+listadd(struct proc **head, struct proc *p)
 {
-	initlock(&ptable.lock, "ptable");
+	p->lnext = *head;
+	if(*head)
+		(*head)->lprev = &p->lnext;
+	p->lprev = head;
+	*head = p;
 }
 
-// Must be called with interrupts disabled
-int
-cpuid()
+static void
+listdel(struct proc *p)
 {
-	return mycpu()-cpus;
+	*p->lprev = p->lnext;
+	if(p->lnext)
+		p->lnext->lprev = p->lprev;
+	p->lnext = 0;
+	p->lprev = 0;
 }
 
-// Must be called with interrupts disabled to avoid the caller being
-// rescheduled between reading lapicid and running through the loop.
-struct cpu*
-mycpu(void)
+// Find the allocated proc with the given pid, or 0.
+// Caller must hold ptable.lock or be inside rcubegin().
+static struct proc*
+pidlookup(int pid)
 {
-	int apicid, i;
+	struct proc *p;
 
-	if(readeflags()&FL_IF)
-		panic("mycpu called with interrupts enabled\n");
-
-	apicid = lapicid();
-	// APIC IDs are not guaranteed to be contiguous. Maybe we should have
-	// a reverse map, or reserve a register to store &cpus[i].
-	for (i = 0; i < ncpu; ++i) {
-		if (cpus[i].apicid == apicid)
-			return &cpus[i];
+	for(p = ptable.pidhash[pid % NPIDHASH]; p; p = p->hnext)
+		if(p->pid == pid)
+			return p;
+	return 0;
+}
+
+static void
+pidunhash(struct proc *p)
+{
+	struct proc **pp;
+
+	for(pp = &ptable.pidhash[p->pid % NPIDHASH]; *pp; pp = &(*pp)->hnext)
+		if(*pp == p){
+			*pp = p->hnext;
+			break;
+		}
+}
+
+// rcufree() callback: no lockless pid lookup can still be
+// looking at the proc, so it may be reused.
+static void
+procfreed(struct rcuhead *h)
+{
+	acquire(&ptable.lock);
+	listadd(&ptable.free, (struct proc*)h);
+	release(&ptable.lock);
+}
+
+// Return p's slot to the free list, after an RCU grace period.
+// The caller has already unlinked p and dealt with its pgdir.
+// Caller must hold ptable.lock.
+static void
+freeproc(struct proc *p)
+{
+	if(p->kstack)
+		kfree(p->kstack);
+	p->kstack = 0;
+	pidunhash(p);
+	p->pgdir = 0;
+	p->pid = 0;
+	p->parent = 0;
+	p->leader = p;
+	p->ustack = 0;
+	p->name[0] = 0;
+	p->killed = 0;
+	p->state = UNUSED;
+	rcufree(&p->rcu, procfreed);
+}
+
+// Carve another page into procs for the free list.
+// Return -1 if maxproc has been reached or memory is short.
+// Caller must hold ptable.lock.
+static int
+growptable(void)
+{
+	struct proc *p, *end;
+	char *mem;
+
+	if(ptable.nproc >= maxproc || (mem = kalloc()) == 0)
+		return -1;
+	memset(mem, 0, PGSIZE);
+	end = (struct proc*)mem + PGSIZE / sizeof(struct proc);
+	for(p = (struct proc*)mem; p < end && ptable.nproc < maxproc; p++){
+		p->anext = ptable.all;
+		ptable.all = p;
+		ptable.nproc++;
+		listadd(&ptable.free, p);
 	}
-	panic("unknown apicid\n");
+	return 0;
+}
+
+// Mark p RUNNABLE and queue it for the scheduler.
+// Caller must hold ptable.lock.
+static void
+setrunnable(struct proc *p)
+{
+	p->state = RUNNABLE;
+	p->rnext = 0;
+	*ptable.runqtail = p;
+	ptable.runqtail = &p->rnext;
 }
 
-// Disable interrupts so that we are not rescheduled
-// while reading proc from the cpu structure
-struct proc*
-myproc(void)
+// Take the oldest RUNNABLE proc off the run queue, or return 0.
+// Caller must hold ptable.lock.
+static struct proc*
+runqget(void)
 {
-	struct cpu *c;
 	struct proc *p;
-	pushcli();
-	c = mycpu();
-	p = c->proc;
-	popcli();
+
+	if((p = ptable.runq) != 0){
+		if((ptable.runq = p->rnext) == 0)
+			ptable.runqtail = &ptable.runq;
+		p->rnext = 0;
+	}
 	return p;
 }
 
+void
+pinit(void)
+{
+	initlock(&ptable.lock, "ptable");
+	ptable.runqtail = &ptable.runq;
+}
+
+// Must be called with interrupts disabled
+int
+cpuid()
+{
+	return mycpu()-cpus;
+}
+
 // Look in the process table for an UNUSED proc.
 // If found, change state to EMBRYO and initialize
 // state required to run in the kernel.
@@ -79,22 +197,40 @@ allocproc(void)
 
 	acquire(&ptable.lock);
 
-	for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-		if(p->state == UNUSED)
-			goto found;
-
-	release(&ptable.lock);
-	return 0;
+	if(ptable.free == 0 && growptable() < 0){
+		release(&ptable.lock);
+		return 0;
+	}
+	p = ptable.free;
+	listdel(p);
 
-found:
 	p->state = EMBRYO;
 	p->pid = nextpid++;
+	p->killed = 0;
+	p->leader = p;
+	p->nthreads = 1;
+	p->vmbusy = 0;
+	p->vmusers = 0;
+	p->vmtop = 0;
+	p->vmheld = 0;
+	p->ustack = 0;
+	p->children = 0;
+	p->zombies = 0;
+	p->threads = 0;
+	p->ring = 0;
+	p->ringbusy = 0;
+	p->systrace = 0;
+	p->hnext = ptable.pidhash[p->pid % NPIDHASH];
+	__sync_synchronize();  // pid and hnext before lockless readers see p
+	ptable.pidhash[p->pid % NPIDHASH] = p;
 
 	release(&ptable.lock);
 
 	// Allocate kernel stack.
 	if((p->kstack = kalloc()) == 0){
-		p->state = UNUSED;
+		acquire(&ptable.lock);
+		freeproc(p);
+		release(&ptable.lock);
 		return 0;
 	}
 	sp = p->kstack + KSTACKSIZE;
@@ -123,6 +259,11 @@ userinit(void)
 	struct proc *p;
 	extern char _binary_user_initcode_start[], _binary_user_initcode_size[];
 
+	// All of memory is on the free list by now, so this is
+	// the place to decide how many processes it can hold.
+	if(maxproc == 0)
+		maxproc = kfreepages() / PROCPAGES;
+
 	p = allocproc();
 
 	initproc = p;
@@ -148,30 +289,164 @@ userinit(void)
 	// because the assignment might not be atomic.
 	acquire(&ptable.lock);
 
-	p->state = RUNNABLE;
+	setrunnable(p);
 
 	release(&ptable.lock);
 }
 
+// Start a kernel thread running fn(arg), which must never
+// return.  It has no user memory, so its page table only maps
+// the kernel.  Return its pid, or -1.
+int
+kthread(char *name, void (*fn)(void*), void *arg)
+{
+	struct proc *p;
+	uint *sp;
+
+	if((p = allocproc()) == 0)
+		return -1;
+	if((p->pgdir = setupkvm()) == 0){
+		acquire(&ptable.lock);
+		freeproc(p);
+		release(&ptable.lock);
+		return -1;
+	}
+	safestrcpy(p->name, name, sizeof(p->name));
+
+	// Start at kthreadret instead of forkret, and have it
+	// "return" into fn with arg on the stack.  The trap frame
+	// is never used, so the words can spill into it.
+	p->context->eip = (uint)kthreadret;
+	sp = (uint*)(p->context + 1);
+	sp[0] = (uint)fn;
+	sp[1] = 0;  // fn's return address
+	sp[2] = (uint)arg;
+
+	acquire(&ptable.lock);
+	setrunnable(p);
+	release(&ptable.lock);
+	return p->pid;
+}
+
+// Threads share the leader's sz, so growproc() and vmtrim()
+// in the same group take turns through leader->vmbusy.
+static void
+vmlock(struct proc *leader)
+{
+	acquire(&ptable.lock);
+	while(leader->vmbusy)
+		sleep(&leader->vmbusy, &ptable.lock);
+	leader->vmbusy = 1;
+	release(&ptable.lock);
+}
+
+static void
+vmunlock(struct proc *leader)
+{
+	acquire(&ptable.lock);
+	leader->vmbusy = 0;
+	wakeup1(&leader->vmbusy);
+	release(&ptable.lock);
+}
+
+// A system call checks user pointers against leader->sz when it
+// starts and uses them until it ends.  So that a shrink cannot
+// unmap pages under another thread's system call, trap() counts
+// the group's system calls in flight with vmhold() and
+// vmrelease(), and growproc() leaves the pages mapped beyond sz
+// until the last of them ends.
+void
+vmhold(void)
+{
+	struct proc *p = myproc();
+
+	p->vmheld = 1;
+	__sync_fetch_and_add(&p->leader->vmusers, 1);
+}
+
+// Free what a shrink left mapped once no system call in the
+// group, or ring operation one of them queued, can still be
+// using it.
+static void
+vmtrim(struct proc *leader)
+{
+	vmlock(leader);
+	if(leader->vmusers == 0 && leader->vmtop > leader->sz){
+		ringdrain(leader);
+		deallocuvmsync(leader->pgdir, leader->vmtop, leader->sz);
+		leader->vmtop = 0;
+	}
+	vmunlock(leader);
+}
+
+void
+vmrelease(void)
+{
+	struct proc *p = myproc();
+	struct proc *leader = p->leader;
+
+	if(!p->vmheld)
+		return;
+	p->vmheld = 0;
+	if(__sync_sub_and_fetch(&leader->vmusers, 1) == 0 && leader->vmtop > leader->sz)
+		vmtrim(leader);
+}
+
 // Grow current process's memory by n bytes.
-// Return 0 on success, -1 on failure.
+// Return the old size on success, -1 on failure.
 int
 growproc(int n)
 {
-	uint sz;
+	uint sz, top;
+	int others, r;
 	struct proc *curproc = myproc();
+	struct proc *leader = curproc->leader;
 
-	sz = curproc->sz;
+	vmlock(leader);
+	sz = leader->sz;
+	top = leader->vmtop > sz ? leader->vmtop : sz;  // mapped below here
+	r = sz;
 	if(n > 0){
-		if((sz = allocuvm(curproc->pgdir, sz, sz + n)) == 0)
-			return -1;
+		if(sz + n < sz)
+			r = -1;
+		else {
+			// Reuse pages a shrink left mapped, cleared like new ones.
+			memset((char*)sz, 0, (sz + n < top ? sz + n : top) - sz);
+			if(allocuvm(curproc->pgdir, top, sz + n) == 0)
+				r = -1;
+			else
+				leader->sz = sz + n;
+		}
 	} else if(n < 0){
-		if((sz = deallocuvm(curproc->pgdir, sz, sz + n)) == 0)
-			return -1;
+		if((uint)-n > sz)
+			r = -1;
+		else {
+			// Calls that start from here on check against the new
+			// sz.  Ring operations queued by earlier ones are
+			// drained after counting those still in flight.
+			leader->sz = sz + n;
+			__sync_synchronize();
+			others = leader->vmusers - curproc->vmheld;
+			ringdrain(leader);
+			if(others == 0){
+				deallocuvmsync(curproc->pgdir, top, sz + n);
+				leader->vmtop = 0;
+			} else
+				leader->vmtop = top;
+		}
 	}
-	curproc->sz = sz;
+	vmunlock(leader);
+
 	switchuvm(curproc);
-	return 0;
+	return r;
+}
+
+// The sysstat run a new child of p is counted in: p's own, or
+// the one p started for its children only (see sysstatctl).
+static int
+childtrace(struct proc *p)
+{
+	return p->systrace < 0 ? -p->systrace : p->systrace;
 }
 
 // Create a new process copying p as the parent.
@@ -183,6 +458,7 @@ fork(void)
 	int i, pid;
 	struct proc *np;
 	struct proc *curproc = myproc();
+	struct proc *leader = curproc->leader;
 
 	// Allocate process.
 	if((np = allocproc()) == 0){
@@ -190,23 +466,24 @@ fork(void)
 	}
 
 	// Copy process state from proc.
-	if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz)) == 0){
-		kfree(np->kstack);
-		np->kstack = 0;
-		np->state = UNUSED;
+	if((np->pgdir = copyuvm(curproc->pgdir, leader->sz)) == 0){
+		acquire(&ptable.lock);
+		freeproc(np);
+		release(&ptable.lock);
 		return -1;
 	}
-	np->sz = curproc->sz;
+	np->sz = leader->sz;
 	np->parent = curproc;
+	np->systrace = childtrace(curproc);
 	*np->tf = *curproc->tf;
 
 	// Clear %eax so that fork returns 0 in the child.
 	np->tf->eax = 0;
 
 	for(i = 0; i < NOFILE; i++)
-		if(curproc->ofile[i])
-			np->ofile[i] = filedup(curproc->ofile[i]);
-	np->cwd = idup(curproc->cwd);
+		if(leader->ofile[i])
+			np->ofile[i] = filedup(leader->ofile[i]);
+	np->cwd = idup(leader->cwd);
 
 	safestrcpy(np->name, curproc->name, sizeof(curproc->name));
 
@@ -214,51 +491,280 @@ fork(void)
 
 	acquire(&ptable.lock);
 
-	np->state = RUNNABLE;
+	listadd(&curproc->children, np);
+	setrunnable(np);
 
 	release(&ptable.lock);
 
 	return pid;
 }
 
+// Create a child process running the program at path, without
+// first copying the caller as fork() does.  If fds is non-zero,
+// the child's fd i is the caller's fd fds[i] for i < NSPAWNFD
+// (closed if fds[i] is -1) and nothing else is inherited;
+// otherwise the child inherits every open file.
+// Returns the child's pid, or -1.
+int
+spawn(char *path, char **argv, int *fds)
+{
+	int i, pid;
+	uint entry, sp;
+	struct proc *np;
+	struct proc *curproc = myproc();
+	struct proc *leader = curproc->leader;
+
+	if(fds){
+		for(i = 0; i < NSPAWNFD; i++)
+			if(fds[i] != -1 &&
+			   (fds[i] < 0 || fds[i] >= NOFILE || leader->ofile[fds[i]] == 0))
+				return -1;
+	}
+
+	// Allocate process.
+	if((np = allocproc()) == 0){
+		return -1;
+	}
+
+	if((np->pgdir = loadimage(path, argv, &np->sz, &entry, &sp)) == 0){
+		acquire(&ptable.lock);
+		freeproc(np);
+		release(&ptable.lock);
+		return -1;
+	}
+	np->parent = curproc;
+	np->systrace = childtrace(curproc);
+
+	// Keep the caller's segments and flags, but start at main.
+	*np->tf = *curproc->tf;
+	np->tf->eip = entry;
+	np->tf->esp = sp;
+
+	if(fds){
+		for(i = 0; i < NSPAWNFD; i++)
+			if(fds[i] != -1)
+				np->ofile[i] = filedup(leader->ofile[fds[i]]);
+	} else {
+		for(i = 0; i < NOFILE; i++)
+			if(leader->ofile[i])
+				np->ofile[i] = filedup(leader->ofile[i]);
+	}
+	np->cwd = idup(leader->cwd);
+
+	setprocname(np, path);
+
+	pid = np->pid;
+
+	acquire(&ptable.lock);
+
+	listadd(&curproc->children, np);
+	setrunnable(np);
+
+	release(&ptable.lock);
+
+	return pid;
+}
+
+// Create a new thread in the current thread group that starts
+// running fn(arg) on the one-page user stack at stack.
+// Returns the new thread's id (its pid), or -1.
+int
+clone(void (*fn)(void*), void *arg, char *stack)
+{
+	int tid;
+	uint sp, ustack[2];
+	struct proc *np;
+	struct proc *curproc = myproc();
+	struct proc *leader = curproc->leader;
+
+	if((uint)stack % PGSIZE != 0 || (uint)stack + PGSIZE > leader->sz)
+		return -1;
+
+	// Allocate process.
+	if((np = allocproc()) == 0){
+		return -1;
+	}
+
+	np->pgdir = curproc->pgdir;
+	np->leader = leader;
+	np->parent = leader;
+	np->ustack = stack;
+	np->systrace = curproc->systrace;
+	*np->tf = *curproc->tf;
+
+	// Enter fn with arg on the new stack and a fake return PC,
+	// the same frame exec() builds for main.
+	ustack[0] = 0xffffffff;
+	ustack[1] = (uint)arg;
+	sp = (uint)stack + PGSIZE - sizeof(ustack);
+	if(copyout(np->pgdir, sp, ustack, sizeof(ustack)) < 0){
+		acquire(&ptable.lock);
+		goto bad;
+	}
+	np->tf->esp = sp;
+	np->tf->eip = (uint)fn;
+
+	safestrcpy(np->name, curproc->name, sizeof(curproc->name));
+
+	tid = np->pid;
+
+	acquire(&ptable.lock);
+
+	// killthreads() may already be tearing down the group.
+	if(curproc->killed)
+		goto bad;
+	leader->nthreads++;
+	listadd(&leader->threads, np);
+	setrunnable(np);
+
+	release(&ptable.lock);
+
+	return tid;
+
+bad:
+	freeproc(np);
+	release(&ptable.lock);
+	return -1;
+}
+
+// Return an exited thread's slot to the table.
+// Caller must hold ptable.lock.
+static void
+freethread(struct proc *p)
+{
+	listdel(p);
+	p->leader->nthreads--;
+	freeproc(p);
+}
+
+// Wait for another thread in the current group to exit and return
+// its id, storing the stack it was given by clone() in *stack.
+// Return -1 if the group has no other threads.
+int
+join(char **stack)
+{
+	struct proc *p;
+	int havethreads, tid;
+	struct proc *curproc = myproc();
+	struct proc *leader = curproc->leader;
+
+	acquire(&ptable.lock);
+	for(;;){
+		// Scan through the group looking for exited threads.
+		havethreads = 0;
+		for(p = leader->threads; p; p = p->lnext){
+			if(p == curproc)
+				continue;
+			havethreads = 1;
+			if(p->state == ZOMBIE){
+				tid = p->pid;
+				*stack = p->ustack;
+				freethread(p);
+				release(&ptable.lock);
+				return tid;
+			}
+		}
+
+		if(!havethreads || curproc->killed){
+			release(&ptable.lock);
+			return -1;
+		}
+
+		// Exiting threads wake their leader (see exit).
+		sleep(leader, &ptable.lock);
+	}
+}
+
+// Kill the other threads in curproc's group and wait until
+// they have all exited.  curproc must be the group leader.
+void
+killthreads(struct proc *curproc)
+{
+	struct proc *p, *next;
+
+	acquire(&ptable.lock);
+	while(curproc->nthreads > 1){
+		for(p = curproc->threads; p; p = next){
+			next = p->lnext;
+			if(p->state == ZOMBIE){
+				freethread(p);
+			} else {
+				p->killed = 1;
+				if(p->state == SLEEPING)
+					setrunnable(p);
+			}
+		}
+		if(curproc->nthreads > 1)
+			sleep(curproc, &ptable.lock);
+	}
+	release(&ptable.lock);
+}
+
+// Hand every proc on list *from to init, appending to *to.
+// Caller must hold ptable.lock.
+static void
+reparent(struct proc **from, struct proc **to)
+{
+	struct proc *p;
+
+	while((p = *from) != 0){
+		listdel(p);
+		p->parent = initproc;
+		listadd(to, p);
+	}
+}
+
 // Exit the current process.  Does not return.
 // An exited process remains in the zombie state
 // until its parent calls wait() to find out it exited.
+// A thread exits alone; the leader takes the whole group with it.
 void
 exit(void)
 {
 	struct proc *curproc = myproc();
-	struct proc *p;
 	int fd;
 
 	if(curproc == initproc)
 		panic("init exiting");
-
-	// Close all open files.
-	for(fd = 0; fd < NOFILE; fd++){
-		if(curproc->ofile[fd]){
-			fileclose(curproc->ofile[fd]);
-			curproc->ofile[fd] = 0;
+	vmrelease();  // If exiting from inside a system call
+
+	if(curproc->leader == curproc){
+		if(curproc->nthreads > 1)
+			killthreads(curproc);
+		ringdrain(curproc);
+
+		// Close all open files.
+		for(fd = 0; fd < NOFILE; fd++){
+			if(curproc->ofile[fd]){
+				fileclose(curproc->ofile[fd]);
+				curproc->ofile[fd] = 0;
+			}
 		}
-	}
 
-	begin_op();
-	iput(curproc->cwd);
-	end_op();
-	curproc->cwd = 0;
+		begin_op();
+		iput(curproc->cwd);
+		end_op();
+		curproc->cwd = 0;
+	}
 
 	acquire(&ptable.lock);
 
 	// Parent might be sleeping in wait().
+	// A thread's parent is its leader, where join() sleeps.
 	wakeup1(curproc->parent);
 
 	// Pass abandoned children to init.
-	for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-		if(p->parent == curproc){
-			p->parent = initproc;
-			if(p->state == ZOMBIE)
-				wakeup1(initproc);
-		}
+	reparent(&curproc->children, &initproc->children);
+	if(curproc->zombies){
+		reparent(&curproc->zombies, &initproc->zombies);
+		wakeup1(initproc);
+	}
+
+	// A process joins its parent's zombies; an exited
+	// thread stays on its leader's thread list for join().
+	if(curproc->leader == curproc){
+		listdel(curproc);
+		listadd(&curproc->parent->zombies, curproc);
 	}
 
 	// Jump into the scheduler, never to return.
@@ -273,35 +779,23 @@ int
 wait(void)
 {
 	struct proc *p;
-	int havekids, pid;
+	int pid;
 	struct proc *curproc = myproc();
 
 	acquire(&ptable.lock);
 	for(;;){
-		// Scan through table looking for exited children.
-		havekids = 0;
-		for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-			if(p->parent != curproc)
-				continue;
-			havekids = 1;
-			if(p->state == ZOMBIE){
-				// Found one.
-				pid = p->pid;
-				kfree(p->kstack);
-				p->kstack = 0;
-				freevm(p->pgdir);
-				p->pid = 0;
-				p->parent = 0;
-				p->name[0] = 0;
-				p->killed = 0;
-				p->state = UNUSED;
-				release(&ptable.lock);
-				return pid;
-			}
+		// Exited children are kept on their own list.
+		if((p = curproc->zombies) != 0){
+			listdel(p);
+			pid = p->pid;
+			freevm(p->pgdir);
+			freeproc(p);
+			release(&ptable.lock);
+			return pid;
 		}
 
 		// No point waiting if we don't have any children.
-		if(!havekids || curproc->killed){
+		if(curproc->children == 0 || curproc->killed){
 			release(&ptable.lock);
 			return -1;
 		}
@@ -317,7 +811,8 @@ wait(void)
 //  - choose a process to run
 //  - swtch to start running that process
 //  - eventually that process transfers control
-//      via swtch back to the scheduler.
+//      via swtch back to the scheduler, once sched()
+//      finds nothing else to switch to directly.
 void
 scheduler(void)
 {
@@ -328,13 +823,12 @@ scheduler(void)
 	for(;;){
 		// Enable interrupts on this processor.
 		sti();
+		c->rcuqs++;
 
-		// Loop over process table looking for process to run.
+		// Run processes from the queue in the order they became
+		// runnable.
 		acquire(&ptable.lock);
-		for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-			if(p->state != RUNNABLE)
-				continue;
-
+		while((p = runqget()) != 0){
 			// Switch to chosen process.  It is the process's job
 			// to release ptable.lock and then reacquire it
 			// before jumping back to us.
@@ -361,11 +855,18 @@ scheduler(void)
 // be proc->intena and proc->ncli, but that would
 // break in the few places where a lock is held but
 // there's no process.
+//
+// When another process is already waiting on the run queue,
+// switch to it directly instead of through the scheduler
+// thread, saving a swtch and the %cr3 load of switchkvm().
+// A yield with nothing else runnable just keeps running.
 void
 sched(void)
 {
 	int intena;
 	struct proc *p = myproc();
+	struct proc *np;
+	struct cpu *c;
 
 	if(!holding(&ptable.lock))
 		panic("sched ptable.lock");
@@ -375,8 +876,19 @@ sched(void)
 		panic("sched running");
 	if(readeflags()&FL_IF)
 		panic("sched interruptible");
-	intena = mycpu()->intena;
-	swtch(&p->context, mycpu()->scheduler);
+	c = mycpu();
+	intena = c->intena;
+	c->rcuqs++;  // No RCU reader can span sched(); see ncli check above
+	if((np = runqget()) == p){
+		p->state = RUNNING;
+	} else if(np){
+		c->proc = np;
+		switchuvm(np);
+		np->state = RUNNING;
+		swtch(&p->context, np->context);
+	} else {
+		swtch(&p->context, c->scheduler);
+	}
 	mycpu()->intena = intena;
 }
 
@@ -385,7 +897,7 @@ void
 yield(void)
 {
 	acquire(&ptable.lock);  //DOC: yieldlock
-	myproc()->state = RUNNABLE;
+	setrunnable(myproc());
 	sched();
 	release(&ptable.lock);
 }
@@ -405,12 +917,23 @@ forkret(void)
 		// be run from main().
 		first = 0;
 		iinit(ROOTDEV);
+		bootstamp("iinit");
 		initlog(ROOTDEV);
+		bootstamp("initlog");
 	}
 
 	// Return to "caller", actually trapret (see allocproc).
 }
 
+// A kernel thread's first scheduling will swtch here.
+// Return into the thread's function (see kthread).
+static void
+kthreadret(void)
+{
+	// Still holding ptable.lock from scheduler.
+	release(&ptable.lock);
+}
+
 // Atomically release lock and sleep on chan.
 // Reacquires lock when awakened.
 void
@@ -457,9 +980,9 @@ wakeup1(void *chan)
 {
 	struct proc *p;
 
-	for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+	for(p = ptable.all; p; p = p->anext)
 		if(p->state == SLEEPING && p->chan == chan)
-			p->state = RUNNABLE;
+			setrunnable(p);
 }
 
 // Wake up all processes sleeping on chan.
@@ -471,6 +994,89 @@ wakeup(void *chan)
 	release(&ptable.lock);
 }
 
+// Wake p if it is sleeping on chan, without scanning the table.
+void
+wakeupproc(struct proc *p, void *chan)
+{
+	acquire(&ptable.lock);
+	if(p->state == SLEEPING && p->chan == chan)
+		setrunnable(p);
+	release(&ptable.lock);
+}
+
+// Wake up at most n processes sleeping on chan
+// and return how many were woken.
+// The ptable lock must be held.
+static int
+wakeupn(void *chan, int n)
+{
+	struct proc *p;
+	int woken;
+
+	woken = 0;
+	for(p = ptable.all; p && woken < n; p = p->anext)
+		if(p->state == SLEEPING && p->chan == chan){
+			setrunnable(p);
+			woken++;
+		}
+	return woken;
+}
+
+// Futexes are keyed by the kernel address of the user word,
+// so every thread sharing the page agrees on the channel.
+static void*
+futexkey(struct proc *p, int *uaddr)
+{
+	char *ka;
+
+	if((uint)uaddr % sizeof(int) != 0)
+		return 0;
+	if((ka = uva2ka(p->pgdir, (char*)PGROUNDDOWN((uint)uaddr))) == 0)
+		return 0;
+	return ka + (uint)uaddr % PGSIZE;
+}
+
+// Sleep on uaddr as long as it still holds val.
+// The comparison is made under ptable.lock, which futexwake()
+// also takes, so a wake that follows the user's own check
+// of *uaddr cannot be lost.
+// Return 0 once woken, -1 if *uaddr != val.
+int
+futexwait(int *uaddr, int val)
+{
+	struct proc *curproc = myproc();
+	int *kaddr;
+
+	if((kaddr = futexkey(curproc, uaddr)) == 0)
+		return -1;
+
+	acquire(&ptable.lock);
+	if(*kaddr != val || curproc->killed){
+		release(&ptable.lock);
+		return -1;
+	}
+	sleep(kaddr, &ptable.lock);
+	release(&ptable.lock);
+	return 0;
+}
+
+// Wake up to n threads waiting on uaddr.
+// Return the number woken, or -1 for a bad address.
+int
+futexwake(int *uaddr, int n)
+{
+	void *chan;
+	int woken;
+
+	if((chan = futexkey(myproc(), uaddr)) == 0)
+		return -1;
+
+	acquire(&ptable.lock);
+	woken = wakeupn(chan, n);
+	release(&ptable.lock);
+	return woken;
+}
+
 // Kill the process with the given pid.
 // Process won't exit until it returns
 // to user space (see trap in trap.c).
@@ -479,19 +1085,22 @@ kill(int pid)
 {
 	struct proc *p;
 
-	acquire(&ptable.lock);
-	for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-		if(p->pid == pid){
-			p->killed = 1;
-			// Wake process from sleep if necessary.
-			if(p->state == SLEEPING)
-				p->state = RUNNABLE;
-			release(&ptable.lock);
-			return 0;
-		}
+	// The lookup needs no lock: p cannot be reused before rcuend().
+	rcubegin();
+	if((p = pidlookup(pid)) == 0){
+		rcuend();
+		return -1;
 	}
-	release(&ptable.lock);
-	return -1;
+	p->killed = 1;
+	// Wake process from sleep if necessary.
+	if(p->state == SLEEPING){
+		acquire(&ptable.lock);
+		if(p->pid == pid && p->state == SLEEPING)
+			setrunnable(p);
+		release(&ptable.lock);
+	}
+	rcuend();
+	return 0;
 }
 
 // Print a process listing to console.  For debugging.
@@ -513,7 +1122,7 @@ procdump(void)
 	char *state;
 	uint pc[10];
 
-	for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+	for(p = ptable.all; p; p = p->anext){
 		if(p->state == UNUSED)
 			continue;
 		if(p->state >= 0 && p->state < NELEM(states) && states[p->state])
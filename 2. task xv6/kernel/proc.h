@@ -1,18 +1,49 @@
-// Per-CPU state
+// Per-CPU state.  Each CPU's %gs segment starts at its
+// struct cpu, so self and proc are one load away (see mycpu()).
+// Aligned so that CPUs do not share cache lines.
 struct cpu {
-	uchar apicid;                // Local APIC ID
+	struct cpu *self;            // This struct; must be first
+	struct proc *proc;           // The process running on this cpu or null
+	uint apicid;                 // Local APIC ID
 	struct context *scheduler;   // swtch() here to enter scheduler
 	struct taskstate ts;         // Used by x86 to find stack for interrupt
 	segdesc gdt[NSEGS];          // x86 global descriptor table
 	volatile uint started;       // Has the CPU started?
 	int ncli;                    // Depth of pushcli nesting.
 	int intena;                  // Were interrupts enabled before pushcli?
-	struct proc *proc;           // The process running on this cpu or null
-};
+	volatile uint tlbgen;        // Bumped each time a TLB shootdown is handled
+	volatile uint rcuqs;         // Bumped at each RCU quiescent state (rcu.c)
+	uint rcusnap;                // rcuqs when the grace period began (rcu.c)
+	uint nintr[NIRQ];            // Interrupts taken, by line (see irqcount)
+	uint sysstack[128];          // sysenter's entry stack (see sysentry)
+} __attribute__((aligned(CACHELINE)));
 
-extern struct cpu cpus[NCPU];
+extern struct cpu *cpus;     // ncpu of them, allocated by mpinit()
 extern int ncpu;
 
+// Return this CPU's struct cpu.  The caller must have interrupts
+// disabled, or it could be moved to another CPU while using it.
+static inline struct cpu*
+mycpu(void)
+{
+	struct cpu *c;
+
+	asm volatile("movl %%gs:0, %0" : "=r" (c));
+	return c;
+}
+
+// Return the current process.  A single load cannot be split by
+// an interrupt, and the running process is the same on whichever
+// CPU it ends up, so no pushcli() is needed.
+static inline struct proc*
+myproc(void)
+{
+	struct proc *p;
+
+	asm volatile("movl %%gs:4, %0" : "=r" (p));
+	return p;
+}
+
 // Saved registers for kernel context switches.
 // Don't need to save all the segment registers (%cs, etc),
 // because they are constant across kernel contexts.
@@ -31,10 +62,17 @@ struct context {
 	uint eip;
 };
 
+// Deferred-free callback, embedded in objects passed to rcufree().
+struct rcuhead {
+	struct rcuhead *next;
+	void (*fn)(struct rcuhead*);
+};
+
 enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
 // Per-process state
 struct proc {
+	struct rcuhead rcu;          // Deferred reuse; must be first (see procfreed)
 	uint sz;                     // Size of process memory (bytes)
 	pde_t* pgdir;                // Page table
 	char *kstack;                // Bottom of kernel stack for this process
@@ -48,8 +86,31 @@ struct proc {
 	struct file *ofile[NOFILE];  // Open files
 	struct inode *cwd;           // Current directory
 	char name[16];               // Process name (debugging)
+	struct proc *leader;         // Thread-group leader (self for a process)
+	int nthreads;                // Threads in group, incl. leader (leader only)
+	int vmbusy;                  // growproc() in progress (leader only)
+	int vmusers;                 // Threads in a system call (leader only)
+	uint vmtop;                  // If > sz, [sz, vmtop) is still mapped (leader only)
+	int vmheld;                  // Counted in leader->vmusers
+	char *ustack;                // User stack passed to clone() (threads only)
+	struct proc *hnext;          // Next in pid hash chain
+	struct proc *lnext;          // Next on free, child, zombie or thread list
+	struct proc **lprev;         // Pointer to this proc on that list
+	struct proc *children;       // Live child processes
+	struct proc *zombies;        // Exited child processes not yet waited for
+	struct proc *threads;        // Other threads in group (leader only)
+	struct proc *rnext;          // Next on run queue
+	struct proc *anext;          // Next in list of all procs
+	struct ring *ring;           // Shared ring, kernel address (leader only)
+	int ringbusy;                // Ring operations in flight (leader only)
+	int systrace;                // sysstat run counting this proc; <0: its children
 };
 
+// Threads created by clone() share the leader's address space,
+// open files and current directory.  Only the leader's sz, ofile[]
+// and cwd are meaningful; every thread keeps its own kstack, tf,
+// context and a copy of the shared pgdir pointer for switchuvm().
+
 // Process memory is laid out contiguously, low addresses first:
 //   text
 //   original data and bss
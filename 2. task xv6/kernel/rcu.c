@@ -0,0 +1,95 @@
+// Read-copy-update.
+//
+// Lookups in read-mostly tables run without the table's lock
+// between rcubegin() and rcuend().  A read section only disables
+// interrupts, so its CPU cannot reach sched() or go round the
+// scheduler loop until the section ends; both count a quiescent
+// state in c->rcuqs.
+//
+// An updater unlinks an object under the table's lock, leaving
+// the object's own links intact for readers still walking past
+// it, and hands it to rcufree().  Once every CPU has counted a
+// quiescent state since then, no reader can still hold a pointer
+// to the object and its callback runs, from the clock interrupt.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+
+struct {
+	struct spinlock lock;
+	struct rcuhead *next;  // Queued since the current grace period began
+	struct rcuhead *cur;   // Waiting for the current grace period
+} rcu;
+
+void
+rcuinit(void)
+{
+	initlock(&rcu.lock, "rcu");
+}
+
+void
+rcubegin(void)
+{
+	pushcli();
+}
+
+void
+rcuend(void)
+{
+	popcli();
+}
+
+// Call fn(h) once no reader can still see the object holding h.
+// May be called with spinlocks held.
+void
+rcufree(struct rcuhead *h, void (*fn)(struct rcuhead*))
+{
+	h->fn = fn;
+	acquire(&rcu.lock);
+	h->next = rcu.next;
+	rcu.next = h;
+	release(&rcu.lock);
+}
+
+// End the current grace period if every CPU has passed a
+// quiescent state, start the next one if callbacks are queued,
+// and run the callbacks whose grace period is over.
+// Called on every clock tick, on every CPU.
+void
+rcupoll(void)
+{
+	struct rcuhead *done, *h;
+	struct cpu *c;
+
+	if(rcu.cur == 0 && rcu.next == 0)
+		return;
+
+	acquire(&rcu.lock);
+	done = 0;
+	if(rcu.cur){
+		for(c = cpus; c < cpus+ncpu; c++)
+			if(c->rcuqs == c->rcusnap)
+				break;
+		if(c == cpus+ncpu){
+			done = rcu.cur;
+			rcu.cur = 0;
+		}
+	}
+	if(rcu.cur == 0 && rcu.next){
+		rcu.cur = rcu.next;
+		rcu.next = 0;
+		for(c = cpus; c < cpus+ncpu; c++)
+			c->rcusnap = c->rcuqs;
+	}
+	release(&rcu.lock);
+
+	while((h = done) != 0){
+		done = h->next;
+		h->fn(h);
+	}
+}
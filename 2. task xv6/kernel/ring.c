@@ -0,0 +1,256 @@
+// Batched, asynchronous system calls through a ring shared
+// with the process (see ring.h).
+//
+// ringenter() consumes many submissions in one trap.  Reads and
+// writes of disk files go to a pool of ring worker threads, so
+// the submitter does not wait for the disk: a worker borrows the
+// submitter's page table to reach its buffer, sleeps in iderw()
+// until the disk interrupt's bottom half wakes it, and posts the
+// completion.  Pipes and devices may block indefinitely, so they
+// run at once in the submitter.  All of one process's operations
+// go to the same worker and run in the order submitted, as its
+// write()s would, so that a write past the end of a file never
+// overtakes the one that extends the file to it.
+//
+// Workers use the submitter's memory and the ring page, so exit,
+// exec and shrinking sbrk first wait in ringdrain() for the
+// process's operations in flight.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "stat.h"
+#include "ring.h"
+
+#define NRINGOP     64  // Operations in flight, system-wide
+#define NRINGWORKER  4
+
+struct ringop {
+	struct ringop *next;
+	struct proc *p;     // Submitter's thread-group leader
+	struct file *f;     // Reference held for the operation
+	struct sqe e;
+};
+
+struct ringq {
+	struct ringop *head;  // Oldest first
+	struct ringop **tail;
+};
+
+// The lock protects the queues, the free list, and every
+// process's ringbusy and cq[]/cqtail.
+static struct {
+	struct spinlock lock;
+	struct ringop op[NRINGOP];
+	struct ringop *free;
+	struct ringq q[NRINGWORKER];  // One per worker
+} rings;
+
+// Post a completion.  Caller must hold rings.lock.
+static void
+post(struct proc *p, uint data, int res)
+{
+	struct cqe *c;
+
+	c = &p->ring->cq[p->ring->cqtail % RINGCQ];
+	c->data = data;
+	c->res = res;
+	p->ring->cqtail++;
+}
+
+static int
+dorw(struct file *f, struct sqe *e)
+{
+	int async = f->type == FD_INODE && f->ip->type != T_DEV;
+
+	if(e->op == RING_READ)
+		return async ? filepread(f, (char*)e->addr, e->n, e->off)
+		             : fileread(f, (char*)e->addr, e->n);
+	return async ? filepwrite(f, (char*)e->addr, e->n, e->off)
+	             : filewrite(f, (char*)e->addr, e->n);
+}
+
+static void
+ringworker(void *arg)
+{
+	struct ringq *q = arg;
+	struct proc *me = myproc();
+	pde_t *kpgdir = me->pgdir;
+	struct ringop *op;
+	int r;
+
+	for(;;){
+		acquire(&rings.lock);
+		while((op = q->head) == 0)
+			sleep(q, &rings.lock);
+		if((q->head = op->next) == 0)
+			q->tail = &q->head;
+		release(&rings.lock);
+
+		me->pgdir = op->p->pgdir;
+		switchuvm(me);
+		r = dorw(op->f, &op->e);
+		me->pgdir = kpgdir;
+		switchuvm(me);
+		fileclose(op->f);
+
+		acquire(&rings.lock);
+		post(op->p, op->e.data, r);
+		op->p->ringbusy--;
+		wakeup(&op->p->ringbusy);
+		op->next = rings.free;
+		rings.free = op;
+		wakeup(&rings.free);
+		release(&rings.lock);
+	}
+}
+
+void
+ringinit(void)
+{
+	struct ringop *op;
+	struct ringq *q;
+
+	initlock(&rings.lock, "rings");
+	for(op = rings.op; op < rings.op+NRINGOP; op++){
+		op->next = rings.free;
+		rings.free = op;
+	}
+	for(q = rings.q; q < rings.q+NRINGWORKER; q++){
+		q->tail = &q->head;
+		if(kthread("ringworker", ringworker, q) < 0)
+			panic("ringinit");
+	}
+}
+
+// Map a ring into the current process at RINGVA, once.
+// Return its user address, or -1.  rings.lock makes threads
+// of one process that race here agree on a single ring.
+int
+ringsetup(void)
+{
+	struct proc *p = myproc()->leader;
+	char *mem;
+
+	if(p->ring)
+		return RINGVA;
+	if((mem = kalloc()) == 0)
+		return -1;
+	memset(mem, 0, PGSIZE);
+	acquire(&rings.lock);
+	if(p->ring == 0){
+		if(mapupage(p->pgdir, RINGVA, mem, PTE_W) < 0){
+			release(&rings.lock);
+			kfree(mem);
+			return -1;
+		}
+		p->ring = (struct ring*)mem;
+		mem = 0;
+	}
+	release(&rings.lock);
+	if(mem)
+		kfree(mem);
+	return RINGVA;
+}
+
+// Check e against the process and return its file, or 0.
+static struct file*
+check(struct proc *p, struct sqe *e)
+{
+	struct file *f;
+
+	if(e->op != RING_READ && e->op != RING_WRITE)
+		return 0;
+	if(e->fd < 0 || e->fd >= NOFILE || (f = p->ofile[e->fd]) == 0)
+		return 0;
+	if(e->n < 0 || e->addr >= p->sz || e->addr + e->n > p->sz ||
+	   e->addr + e->n < e->addr)
+		return 0;
+	return f;
+}
+
+// Consume up to n submissions, then wait until at least min
+// completions are ready or nothing is left in flight.
+// Return the number of submissions consumed, or -1.
+int
+ringenter(int n, int min)
+{
+	struct proc *p = myproc()->leader;
+	struct ring *r = p->ring;
+	struct ringq *q = &rings.q[p->pid % NRINGWORKER];
+	struct ringop *op;
+	struct file *f;
+	struct sqe e;
+	int i, res;
+
+	if(r == 0 || n < 0)
+		return -1;
+
+	for(i = 0; i < n && r->sqhead != r->sqtail; i++){
+		// Leave room in cq[] for everything in flight.
+		acquire(&rings.lock);
+		if(r->cqtail - r->cqhead + p->ringbusy >= RINGCQ){
+			release(&rings.lock);
+			break;
+		}
+		release(&rings.lock);
+
+		// The process can change the entry under us, so copy it.
+		e = r->sq[r->sqhead % RINGSQ];
+		r->sqhead++;
+
+		res = e.op == RING_NOP ? 0 : -1;
+		if(e.op != RING_NOP && (f = check(p, &e)) != 0){
+			acquire(&rings.lock);
+			if(f->type == FD_INODE && f->ip->type != T_DEV){
+				// Running it here instead would break the order.
+				while((op = rings.free) == 0)
+					sleep(&rings.free, &rings.lock);
+				rings.free = op->next;
+				op->next = 0;
+				op->p = p;
+				op->f = filedup(f);
+				op->e = e;
+				*q->tail = op;
+				q->tail = &op->next;
+				p->ringbusy++;
+				wakeup(q);
+				release(&rings.lock);
+				continue;
+			}
+			release(&rings.lock);
+			res = dorw(f, &e);
+		}
+		acquire(&rings.lock);
+		post(p, e.data, res);
+		release(&rings.lock);
+	}
+
+	acquire(&rings.lock);
+	while(r->cqtail - r->cqhead < min && p->ringbusy > 0){
+		if(myproc()->killed){
+			release(&rings.lock);
+			return -1;
+		}
+		sleep(&p->ringbusy, &rings.lock);
+	}
+	release(&rings.lock);
+	return i;
+}
+
+// Wait for p's ring operations in flight to finish.
+void
+ringdrain(struct proc *p)
+{
+	acquire(&rings.lock);
+	while(p->ringbusy > 0)
+		sleep(&p->ringbusy, &rings.lock);
+	release(&rings.lock);
+}
@@ -0,0 +1,38 @@
+// Submission/completion ring shared by a process and the
+// kernel (see ring.c).  The process fills sq[] and advances
+// sqtail, then calls ringenter(); the kernel posts a result to
+// cq[] for every entry it consumes and advances cqtail.  The
+// process reads completions and advances cqhead.  Indices run
+// freely and are taken modulo the ring sizes.
+
+#define RING_NOP   0  // Complete at once with res 0
+#define RING_READ  1  // Like read(), or pread() on a disk file
+#define RING_WRITE 2  // Like write(), or pwrite() on a disk file
+
+#define RINGSQ  64
+#define RINGCQ 128
+
+// Submission queue entry.
+struct sqe {
+	int op;     // RING_*
+	int fd;
+	uint addr;  // User buffer
+	int n;      // Bytes
+	uint off;   // File offset; ignored for pipes and devices
+	uint data;  // Copied to the completion untouched
+};
+
+// Completion queue entry.
+struct cqe {
+	uint data;
+	int res;    // What read() or write() would have returned
+};
+
+struct ring {
+	uint sqhead;  // Next entry the kernel will consume
+	uint sqtail;  // Next entry the process will fill
+	uint cqhead;  // Next completion the process will read
+	uint cqtail;  // Next completion the kernel will post
+	struct sqe sq[RINGSQ];
+	struct cqe cq[RINGCQ];
+};
@@ -10,37 +10,173 @@
 #include "spinlock.h"
 #include "sleeplock.h"
 
+// How many times acquiresleep() polls a lock whose holder is
+// running before it gives up and sleeps.
+#define SPINMAX 2000
+
+// A process waiting for a sleeplock.  Lives on the waiter's
+// stack; release hands the lock to the oldest waiter (or to a
+// run of readers at the head of the queue) by setting granted,
+// so nobody has to race to retake it.
+struct slwaiter {
+	struct proc *p;
+	struct slwaiter *next;
+	int shared;
+	int granted;
+};
+
 void
 initsleeplock(struct sleeplock *lk, char *name)
 {
 	initlock(&lk->lk, "sleep lock");
 	lk->name = name;
 	lk->locked = 0;
+	lk->readers = 0;
+	lk->owner = 0;
+	lk->head = 0;
+	lk->tail = 0;
 	lk->pid = 0;
+	lk->stat = lockstatslot(name);
+	lk->tacquired = 0;
 }
 
-void
-acquiresleep(struct sleeplock *lk)
+// Can lk be taken in the given mode right now?  Readers do not
+// pass queued waiters, so a stream of them cannot starve a writer.
+static int
+canacquire(struct sleeplock *lk, int shared)
+{
+	if(shared)
+		return !lk->locked && lk->head == 0;
+	return !lk->locked && lk->readers == 0;
+}
+
+// Hold lk->lk.  Wait for lk until it is free or until the
+// holder stops running, since a running holder of a short
+// critical section is likely to finish before a sleep and
+// wakeup would.  Readers hold no owner, so a lock held shared
+// is not spun on.  Return 1 if lk can now be taken.
+static int
+spinwait(struct sleeplock *lk, int shared)
 {
+	int i;
+	struct proc *owner;
+
+	for(i = 0; i < SPINMAX; i++){
+		owner = lk->owner;
+		if(owner == 0 || owner->state != RUNNING)
+			break;
+		release(&lk->lk);
+		pause();
+		acquire(&lk->lk);
+		if(canacquire(lk, shared))
+			return 1;
+	}
+	return canacquire(lk, shared);
+}
+
+static void
+take(struct sleeplock *lk, struct proc *p, int shared)
+{
+	if(shared){
+		lk->readers++;
+	} else {
+		lk->locked = 1;
+		lk->owner = p;
+		lk->pid = p->pid;
+	}
+}
+
+static void
+acquiremode(struct sleeplock *lk, int shared)
+{
+	uint64 t0;
+	int contended;
+	struct slwaiter w;
+	struct proc *p = myproc();
+
 	acquire(&lk->lk);
-	while (lk->locked) {
-		sleep(lk, &lk->lk);
+	t0 = lockstaton ? rdtsc() : 0;
+	contended = !canacquire(lk, shared);
+	if(!contended || spinwait(lk, shared)){
+		take(lk, p, shared);
+	} else {
+		// Queue up; the releaser makes us a holder.
+		w.p = p;
+		w.next = 0;
+		w.shared = shared;
+		w.granted = 0;
+		if(lk->tail)
+			lk->tail->next = &w;
+		else
+			lk->head = &w;
+		lk->tail = &w;
+		while(!w.granted)
+			sleep(&w, &lk->lk);
+	}
+	if(t0){
+		lockstatacquired(lk->stat, contended, rdtsc() - t0);
+		if(!shared)
+			lk->tacquired = rdtsc();
 	}
-	lk->locked = 1;
-	lk->pid = myproc()->pid;
 	release(&lk->lk);
 }
 
+void
+acquiresleep(struct sleeplock *lk)
+{
+	acquiremode(lk, 0);
+}
+
+void
+acquiresleepshared(struct sleeplock *lk)
+{
+	acquiremode(lk, 1);
+}
+
+// Hand a free lock to the oldest waiter, and if that is a
+// reader, to every reader queued directly behind it.
+// Caller holds lk->lk.
+static void
+handoff(struct sleeplock *lk)
+{
+	struct slwaiter *w;
+
+	while((w = lk->head) != 0){
+		if(lk->locked || (!w->shared && lk->readers > 0))
+			break;
+		if((lk->head = w->next) == 0)
+			lk->tail = 0;
+		take(lk, w->p, w->shared);
+		w->granted = 1;
+		wakeupproc(w->p, w);
+		if(!w->shared)
+			break;
+	}
+}
+
+// Release lk, whichever way the caller holds it.
 void
 releasesleep(struct sleeplock *lk)
 {
 	acquire(&lk->lk);
-	lk->locked = 0;
-	lk->pid = 0;
-	wakeup(lk);
+	if(lk->locked){
+		if(lk->tacquired){
+			lockstatreleased(lk->stat, lk->tacquired);
+			lk->tacquired = 0;
+		}
+		lk->locked = 0;
+		lk->owner = 0;
+		lk->pid = 0;
+	} else if(lk->readers > 0){
+		lk->readers--;
+	} else {
+		panic("releasesleep");
+	}
+	handoff(lk);
 	release(&lk->lk);
 }
 
+// Is lk held exclusively by the current process?
 int
 holdingsleep(struct sleeplock *lk)
 {
@@ -51,6 +187,3 @@ holdingsleep(struct sleeplock *lk)
 	release(&lk->lk);
 	return r;
 }
-
-
-
@@ -1,10 +1,17 @@
-// Long-term locks for processes
+// Long-term locks for processes.
+// Held either exclusively by one process or shared by readers.
 struct sleeplock {
-	uint locked;       // Is the lock held?
+	uint locked;       // Is the lock held exclusively?
+	int readers;       // Processes holding the lock shared
 	struct spinlock lk; // spinlock protecting this sleep lock
+	struct proc *owner; // Process holding lock
+	struct slwaiter *head; // Queue of sleeping waiters, oldest first
+	struct slwaiter *tail;
 
 	// For debugging:
 	char *name;        // Name of lock.
 	int pid;           // Process holding lock
+	int stat;          // Slot for name in the lockstat table, or -1
+	uint64 tacquired;  // rdtsc() at acquire, if lockstat is recording
 };
 
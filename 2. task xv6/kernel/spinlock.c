@@ -8,13 +8,39 @@
 #include "mmu.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "lockstat.h"
 
 void
 initlock(struct spinlock *lk, char *name)
 {
 	lk->name = name;
-	lk->locked = 0;
+	lk->next = 0;
+	lk->owner = 0;
 	lk->cpu = 0;
+	lk->stat = lockstatslot(name);
+	lk->tacquired = 0;
+}
+
+static void
+spin(struct spinlock *lk, uint ticket)
+{
+	uint64 t0;
+
+	if(!lockstaton){
+		while(lk->owner != ticket)
+			pause();
+		return;
+	}
+
+	t0 = rdtsc();
+	if(lk->owner == ticket){
+		lockstatacquired(lk->stat, 0, 0);
+	} else {
+		while(lk->owner != ticket)
+			pause();
+		lockstatacquired(lk->stat, 1, rdtsc() - t0);
+	}
+	lk->tacquired = rdtsc();
 }
 
 // Acquire the lock.
@@ -24,13 +50,16 @@ initlock(struct spinlock *lk, char *name)
 void
 acquire(struct spinlock *lk)
 {
+	uint ticket;
+
 	pushcli(); // disable interrupts to avoid deadlock.
 	if(holding(lk))
 		panic("acquire");
 
-	// The xchg is atomic.
-	while(xchg(&lk->locked, 1) != 0)
-		;
+	// The lock xadd is atomic.  Waiters only read owner, so the
+	// line stays shared until the holder's release writes it.
+	ticket = __sync_fetch_and_add(&lk->next, 1);
+	spin(lk, ticket);
 
 	// Tell the C compiler and the processor to not move loads or stores
 	// past this point, to ensure that the critical section's memory
@@ -39,7 +68,9 @@ acquire(struct spinlock *lk)
 
 	// Record info about lock acquisition for debugging.
 	lk->cpu = mycpu();
+#ifdef LOCKDEBUG
 	getcallerpcs(&lk, lk->pcs);
+#endif
 }
 
 // Release the lock.
@@ -49,8 +80,14 @@ release(struct spinlock *lk)
 	if(!holding(lk))
 		panic("release");
 
+#ifdef LOCKDEBUG
 	lk->pcs[0] = 0;
+#endif
 	lk->cpu = 0;
+	if(lk->tacquired){
+		lockstatreleased(lk->stat, lk->tacquired);
+		lk->tacquired = 0;
+	}
 
 	// Tell the C compiler and the processor to not move loads or stores
 	// past this point, to ensure that all the stores in the critical
@@ -59,10 +96,9 @@ release(struct spinlock *lk)
 	// stores; __sync_synchronize() tells them both not to.
 	__sync_synchronize();
 
-	// Release the lock, equivalent to lk->locked = 0.
-	// This code can't use a C assignment, since it might
-	// not be atomic. A real OS would use C atomics here.
-	asm volatile("movl $0, %0" : "+m" (lk->locked) : );
+	// Serve the next ticket.  Only the holder writes owner,
+	// so a plain aligned store suffices.
+	lk->owner = lk->owner + 1;
 
 	popcli();
 }
@@ -91,7 +127,7 @@ holding(struct spinlock *lock)
 {
 	int r;
 	pushcli();
-	r = lock->locked && lock->cpu == mycpu();
+	r = lock->owner != lock->next && lock->cpu == mycpu();
 	popcli();
 	return r;
 }
@@ -124,3 +160,147 @@ popcli(void)
 		sti();
 }
 
+// Lock statistics.  Counters are kept per lock name, since many
+// locks (buffers, inodes, pipes) share one, and per CPU so that
+// recording needs no atomics: every update happens with
+// interrupts off, under the lock being measured or its guard.
+
+#define NLOCKSTAT 64
+
+struct lockcount {
+	uint acquires;
+	uint contended;
+	uint64 wait;
+	uint64 maxhold;
+};
+
+static struct {
+	char *name[NLOCKSTAT];
+	struct lockcount (*count)[NLOCKSTAT];  // One row per CPU, from kallocn
+} lockstats;
+
+int lockstaton;  // Recording?  Tested on every acquire.
+
+// Return the table slot for name, claiming a free one if needed,
+// or -1 if the table is full.  Called from initlock(), so it
+// cannot itself take a lock; a slot is claimed with a CAS.
+int
+lockstatslot(char *name)
+{
+	int i;
+	char *s;
+
+	for(i = 0; i < NLOCKSTAT; i++){
+		s = lockstats.name[i];
+		if(s == 0 && (s = __sync_val_compare_and_swap(&lockstats.name[i], 0, name)) == 0)
+			return i;
+		if(strncmp(s, name, sizeof(((struct lockstat*)0)->name)) == 0)
+			return i;
+	}
+	return -1;
+}
+
+void
+lockstatacquired(int slot, int contended, uint64 wait)
+{
+	struct lockcount *c;
+
+	if(slot < 0)
+		return;
+	c = &lockstats.count[cpuid()][slot];
+	c->acquires++;
+	if(contended){
+		c->contended++;
+		c->wait += wait;
+	}
+}
+
+void
+lockstatreleased(int slot, uint64 tacquired)
+{
+	struct lockcount *c;
+	uint64 hold;
+
+	if(slot < 0)
+		return;
+	c = &lockstats.count[cpuid()][slot];
+	hold = rdtsc() - tacquired;
+	if(hold > c->maxhold)
+		c->maxhold = hold;
+}
+
+// Allocate the counters, one row per CPU, when first recording.
+static int
+lockstatalloc(void)
+{
+	char *mem;
+	int n;
+
+	if(lockstats.count)
+		return 0;
+	n = PGROUNDUP(ncpu * sizeof(lockstats.count[0])) / PGSIZE;
+	if((mem = kallocn(n)) == 0)
+		return -1;
+	if(!__sync_bool_compare_and_swap((char**)&lockstats.count, 0, mem))
+		kfreen(mem, n);
+	return 0;
+}
+
+// Start or stop recording, or copy up to n entries, sorted by
+// name, to ls.  Returns the number of entries copied.
+int
+lockstatctl(int cmd, struct lockstat *ls, int n)
+{
+	struct lockstat e;
+	struct lockcount *c;
+	int i, j, k;
+	uint64 wait, maxhold;
+
+	switch(cmd){
+	case LS_START:
+		lockstaton = 0;
+		if(lockstatalloc() < 0)
+			return -1;
+		memset(lockstats.count, 0, ncpu * sizeof(lockstats.count[0]));
+		lockstaton = 1;
+		return 0;
+	case LS_STOP:
+		lockstaton = 0;
+		return 0;
+	case LS_READ:
+		break;
+	default:
+		return -1;
+	}
+
+	if(lockstats.count == 0)
+		return 0;
+	k = 0;
+	for(i = 0; i < NLOCKSTAT && lockstats.name[i]; i++){
+		memset(&e, 0, sizeof(e));
+		safestrcpy(e.name, lockstats.name[i], sizeof(e.name));
+		wait = maxhold = 0;
+		for(j = 0; j < ncpu; j++){
+			c = &lockstats.count[j][i];
+			e.acquires += c->acquires;
+			e.contended += c->contended;
+			wait += c->wait;
+			if(c->maxhold > maxhold)
+				maxhold = c->maxhold;
+		}
+		if(e.acquires == 0)
+			continue;
+		e.waitkcycles = wait >> 10;
+		e.maxhold = maxhold > 0xffffffff ? 0xffffffff : maxhold;
+
+		// Insertion sort by name.
+		for(j = k; j > 0 && strncmp(ls[j-1].name, e.name, sizeof(e.name)) > 0; j--)
+			if(j < n)
+				ls[j] = ls[j-1];
+		if(j < n)
+			ls[j] = e;
+		if(k < n)
+			k++;
+	}
+	return k;
+}
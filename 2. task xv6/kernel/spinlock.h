@@ -1,11 +1,19 @@
 // Mutual exclusion lock.
+// A ticket lock: CPUs take increasing tickets from next and are
+// served in order as owner catches up, so waiters cannot starve.
+// The lock is held while owner != next.
 struct spinlock {
-	uint locked;       // Is the lock held?
+	volatile uint next;   // Next ticket to hand out
+	volatile uint owner;  // Ticket being served
 
 	// For debugging:
 	char *name;        // Name of lock.
 	struct cpu *cpu;   // The cpu holding the lock.
+	int stat;          // Slot for name in the lockstat table, or -1
+	uint64 tacquired;  // rdtsc() at acquire, if lockstat is recording
+#ifdef LOCKDEBUG
 	uint pcs[10];      // The call stack (an array of program counters)
 			   // that locked the lock.
+#endif
 };
 
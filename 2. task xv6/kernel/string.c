@@ -1,14 +1,28 @@
 #include "types.h"
 #include "x86.h"
 
+// memset, memmove, memcmp and strlen do the bulk of their work a
+// word at a time, with the string instructions where they fit,
+// and only the ends a byte at a time.
+
 void*
 memset(void *dst, int c, uint n)
 {
-	if ((int)dst%4 == 0 && n%4 == 0){
-		c &= 0xFF;
-		stosl(dst, (c<<24)|(c<<16)|(c<<8)|c, n/4);
-	} else
-		stosb(dst, c, n);
+	char *d;
+	uint k;
+
+	d = dst;
+	c &= 0xFF;
+	if(n >= 16){
+		k = -(uint)d & 3;
+		stosb(d, c, k);
+		d += k;
+		n -= k;
+		stosl(d, (uint)(uchar)c * 0x01010101, n/4);
+		d += n & ~3;
+		n &= 3;
+	}
+	stosb(d, c, n);
 	return dst;
 }
 
@@ -19,6 +33,9 @@ memcmp(const void *v1, const void *v2, uint n)
 
 	s1 = v1;
 	s2 = v2;
+	// Skip the equal words, then find the byte that differs.
+	while(n >= 4 && *(uint*)s1 == *(uint*)s2)
+		s1 += 4, s2 += 4, n -= 4;
 	while(n-- > 0){
 		if(*s1 != *s2)
 			return *s1 - *s2;
@@ -33,17 +50,30 @@ memmove(void *dst, const void *src, uint n)
 {
 	const char *s;
 	char *d;
+	int d0, d1, d2;
 
 	s = src;
 	d = dst;
 	if(s < d && s + n > d){
-		s += n;
-		d += n;
-		while(n-- > 0)
-			*--d = *--s;
+		// Copy downwards: the n%4 top bytes, then the words
+		// below them.
+		asm volatile("std; rep movsb\n\t"
+			     "subl $3, %%esi\n\t"
+			     "subl $3, %%edi\n\t"
+			     "movl %4, %%ecx\n\t"
+			     "shrl $2, %%ecx\n\t"
+			     "rep movsl; cld" :
+			     "=&c" (d0), "=&D" (d1), "=&S" (d2) :
+			     "0" (n & 3), "g" (n), "1" (d + n - 1), "2" (s + n - 1) :
+			     "memory", "cc");
 	} else
-		while(n-- > 0)
-			*d++ = *s++;
+		asm volatile("cld; rep movsl\n\t"
+			     "movl %4, %%ecx\n\t"
+			     "andl $3, %%ecx\n\t"
+			     "rep movsb" :
+			     "=&c" (d0), "=&D" (d1), "=&S" (d2) :
+			     "0" (n / 4), "g" (n), "1" (d), "2" (s) :
+			     "memory", "cc");
 
 	return dst;
 }
@@ -93,13 +123,20 @@ safestrcpy(char *s, const char *t, int n)
 	return os;
 }
 
+// Scan aligned words, which never cross into an unmapped page,
+// for one with a zero byte.
 int
 strlen(const char *s)
 {
-	int n;
+	const char *p;
+	const uint *w;
 
-	for(n = 0; s[n]; n++)
+	for(p = s; (uint)p & 3; p++)
+		if(*p == 0)
+			return p - s;
+	for(w = (const uint*)p; ((*w - 0x01010101) & ~*w & 0x80808080) == 0; w++)
 		;
-	return n;
+	for(p = (const char*)w; *p; p++)
+		;
+	return p - s;
 }
-
@@ -6,8 +6,10 @@
 #include "proc.h"
 #include "x86.h"
 #include "syscall.h"
+#include "sysstat.h"
 
-// User code makes a system call with INT T_SYSCALL.
+// User code makes a system call with INT T_SYSCALL or with
+// sysenter; both build the same trap frame (see trapasm.S).
 // System call number in %eax.
 // Arguments on the stack, from the user call to the C
 // library system call function. The saved user %esp points
@@ -17,9 +19,9 @@
 int
 fetchint(uint addr, int *ip)
 {
-	struct proc *curproc = myproc();
+	uint sz = myproc()->leader->sz;
 
-	if(addr >= curproc->sz || addr+4 > curproc->sz)
+	if(addr >= sz || addr+4 > sz)
 		return -1;
 	*ip = *(int*)(addr);
 	return 0;
@@ -32,12 +34,12 @@ int
 fetchstr(uint addr, char **pp)
 {
 	char *s, *ep;
-	struct proc *curproc = myproc();
+	uint sz = myproc()->leader->sz;
 
-	if(addr >= curproc->sz)
+	if(addr >= sz)
 		return -1;
 	*pp = (char*)addr;
-	ep = (char*)curproc->sz;
+	ep = (char*)sz;
 	for(s = *pp; s < ep; s++){
 		if(*s == 0)
 			return s - *pp;
@@ -59,20 +61,31 @@ int
 argptr(int n, char **pp, int size)
 {
 	int i;
-	struct proc *curproc = myproc();
+	uint sz = myproc()->leader->sz;
 
 	if(argint(n, &i) < 0)
 		return -1;
-	if(size < 0 || (uint)i >= curproc->sz || (uint)i+size > curproc->sz)
+	if(size < 0 || (uint)i >= sz || (uint)i+size > sz)
 		return -1;
 	*pp = (char*)i;
 	return 0;
 }
 
+// Fetch the nth word-sized system call argument as a pointer
+// to an array of count elements of size bytes each, checking
+// count before multiplying so that the total cannot wrap.
+int
+argarray(int n, char **pp, int count, int size)
+{
+	if(count < 0 || size <= 0 || count > 0x7fffffff / size)
+		return -1;
+	return argptr(n, pp, count*size);
+}
+
 // Fetch the nth word-sized system call argument as a string pointer.
 // Check that the pointer is valid and the string is nul-terminated.
-// (There is no shared writable memory, so the string can't change
-// between this check and being used by the kernel.)
+// (Another thread in the group could change the string after
+// this check; callers only ever read it, so that is harmless.)
 int
 argstr(int n, char **pp)
 {
@@ -107,6 +120,20 @@ extern int sys_setkey(void);
 extern int sys_setecho(void);
 extern int sys_encr(void);
 extern int sys_decr(void);
+extern int sys_clone(void);
+extern int sys_join(void);
+extern int sys_futexwait(void);
+extern int sys_futexwake(void);
+extern int sys_spawn(void);
+extern int sys_lockstat(void);
+extern int sys_irqroute(void);
+extern int sys_irqstat(void);
+extern int sys_ringsetup(void);
+extern int sys_ringenter(void);
+extern int sys_clockgettime(void);
+extern int sys_sysstat(void);
+extern int sys_bootstat(void);
+extern int sys_tune(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -134,17 +161,196 @@ static int (*syscalls[])(void) = {
 [SYS_setecho] sys_setecho,
 [SYS_encr]    sys_encr,
 [SYS_decr]    sys_decr,
+[SYS_clone]   sys_clone,
+[SYS_join]    sys_join,
+[SYS_futexwait] sys_futexwait,
+[SYS_futexwake] sys_futexwake,
+[SYS_spawn]   sys_spawn,
+[SYS_lockstat] sys_lockstat,
+[SYS_irqroute] sys_irqroute,
+[SYS_irqstat] sys_irqstat,
+[SYS_ringsetup] sys_ringsetup,
+[SYS_ringenter] sys_ringenter,
+[SYS_clockgettime] sys_clockgettime,
+[SYS_sysstat] sys_sysstat,
+[SYS_bootstat] sys_bootstat,
+[SYS_tune]    sys_tune,
 };
 
+static char *sysnames[] = {
+[SYS_fork]    "fork",
+[SYS_exit]    "exit",
+[SYS_wait]    "wait",
+[SYS_pipe]    "pipe",
+[SYS_read]    "read",
+[SYS_kill]    "kill",
+[SYS_exec]    "exec",
+[SYS_fstat]   "fstat",
+[SYS_chdir]   "chdir",
+[SYS_dup]     "dup",
+[SYS_getpid]  "getpid",
+[SYS_sbrk]    "sbrk",
+[SYS_sleep]   "sleep",
+[SYS_uptime]  "uptime",
+[SYS_open]    "open",
+[SYS_write]   "write",
+[SYS_mknod]   "mknod",
+[SYS_unlink]  "unlink",
+[SYS_link]    "link",
+[SYS_mkdir]   "mkdir",
+[SYS_close]   "close",
+[SYS_setkey]  "setkey",
+[SYS_setecho] "setecho",
+[SYS_encr]    "encr",
+[SYS_decr]    "decr",
+[SYS_clone]   "clone",
+[SYS_join]    "join",
+[SYS_futexwait] "futexwait",
+[SYS_futexwake] "futexwake",
+[SYS_spawn]   "spawn",
+[SYS_lockstat] "lockstat",
+[SYS_irqroute] "irqroute",
+[SYS_irqstat] "irqstat",
+[SYS_ringsetup] "ringsetup",
+[SYS_ringenter] "ringenter",
+[SYS_clockgettime] "clockgettime",
+[SYS_sysstat] "sysstat",
+[SYS_bootstat] "bootstat",
+[SYS_tune]    "tune",
+};
+
+// Per-syscall accounting, read by the sysstat tool.
+
+struct syscount {
+	uint calls;
+	uint errors;
+	uint64 cycles;
+	uint hist[NSYSHIST];
+};
+
+static struct {
+	struct syscount (*count)[NELEM(syscalls)];  // One row per CPU, from kallocn
+} sysstats;
+
+static int sysstaton;   // Recording?  Tested on every system call.
+static int sysstatall;  // Counting every process, not just one run's?
+static int sysstatrun;  // Current run, matched against p->systrace
+
+static void
+sysstatcount(struct proc *p, int num, uint64 t)
+{
+	struct syscount *c;
+	uint cycles;
+	int b;
+
+	if(!sysstatall && p->systrace != sysstatrun)
+		return;
+	cycles = t > 0xffffffff ? 0xffffffff : t;
+	b = cycles ? 31 - __builtin_clz(cycles) : 0;
+	if(b >= NSYSHIST)
+		b = NSYSHIST-1;
+
+	pushcli();
+	c = &sysstats.count[cpuid()][num];
+	c->calls++;
+	if((int)p->tf->eax < 0)
+		c->errors++;
+	c->cycles += t;
+	c->hist[b]++;
+	popcli();
+}
+
+// Allocate the counters, one row per CPU, when first recording.
+static int
+sysstatalloc(void)
+{
+	char *mem;
+	int n;
+
+	if(sysstats.count)
+		return 0;
+	n = PGROUNDUP(ncpu * sizeof(sysstats.count[0])) / PGSIZE;
+	if((mem = kallocn(n)) == 0)
+		return -1;
+	if(!__sync_bool_compare_and_swap((char**)&sysstats.count, 0, mem))
+		kfreen(mem, n);
+	return 0;
+}
+
+// Start or stop recording, or copy up to n entries, in system
+// call order, to ss.  Returns the number of entries copied.
+// SS_CHILD counts only processes the caller creates afterwards,
+// and their descendants; see childtrace() in proc.c.
+int
+sysstatctl(int cmd, struct sysstat *ss, int n)
+{
+	struct syscount *c;
+	struct sysstat *e;
+	int b, i, j, k;
+	uint64 cycles;
+
+	switch(cmd){
+	case SS_START:
+	case SS_CHILD:
+		sysstaton = 0;
+		if(sysstatalloc() < 0)
+			return -1;
+		memset(sysstats.count, 0, ncpu * sizeof(sysstats.count[0]));
+		sysstatall = cmd == SS_START;
+		sysstatrun++;
+		if(cmd == SS_CHILD)
+			myproc()->systrace = -sysstatrun;
+		sysstaton = 1;
+		return 0;
+	case SS_STOP:
+		sysstaton = 0;
+		return 0;
+	case SS_READ:
+		break;
+	default:
+		return -1;
+	}
+
+	if(sysstats.count == 0)
+		return 0;
+	k = 0;
+	for(i = 1; i < NELEM(syscalls) && k < n; i++){
+		e = &ss[k];
+		memset(e, 0, sizeof(*e));
+		cycles = 0;
+		for(j = 0; j < ncpu; j++){
+			c = &sysstats.count[j][i];
+			e->calls += c->calls;
+			e->errors += c->errors;
+			cycles += c->cycles;
+			for(b = 0; b < NSYSHIST; b++)
+				e->hist[b] += c->hist[b];
+		}
+		if(e->calls == 0)
+			continue;
+		safestrcpy(e->name, sysnames[i], sizeof(e->name));
+		e->num = i;
+		e->kcycles = cycles >> 10;
+		k++;
+	}
+	return k;
+}
+
 void
 syscall(void)
 {
 	int num;
+	uint64 t0;
 	struct proc *curproc = myproc();
 
 	num = curproc->tf->eax;
 	if(num > 0 && num < NELEM(syscalls) && syscalls[num]) {
-		curproc->tf->eax = syscalls[num]();
+		if(sysstaton){
+			t0 = rdtsc();
+			curproc->tf->eax = syscalls[num]();
+			sysstatcount(curproc, num, rdtsc() - t0);
+		} else
+			curproc->tf->eax = syscalls[num]();
 	} else {
 		cprintf("%d %s: unknown sys call %d\n",
 			curproc->pid, curproc->name, num);
@@ -23,4 +23,18 @@
 #define SYS_setkey  22
 #define SYS_setecho 23
 #define SYS_encr    24
-#define SYS_decr    25
\ No newline at end of file
+#define SYS_decr    25
+#define SYS_clone   26
+#define SYS_join    27
+#define SYS_futexwait 28
+#define SYS_futexwake 29
+#define SYS_spawn   30
+#define SYS_lockstat 31
+#define SYS_irqroute 32
+#define SYS_irqstat 33
+#define SYS_ringsetup 34
+#define SYS_ringenter 35
+#define SYS_clockgettime 36
+#define SYS_sysstat 37
+#define SYS_bootstat 38
+#define SYS_tune 39
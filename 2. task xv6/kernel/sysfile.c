@@ -28,7 +28,7 @@ argfd(int n, int *pfd, struct file **pf)
 
 	if(argint(n, &fd) < 0)
 		return -1;
-	if(fd < 0 || fd >= NOFILE || (f=myproc()->ofile[fd]) == 0)
+	if(fd < 0 || fd >= NOFILE || (f=myproc()->leader->ofile[fd]) == 0)
 		return -1;
 	if(pfd)
 		*pfd = fd;
@@ -43,7 +43,7 @@ static int
 fdalloc(struct file *f)
 {
 	int fd;
-	struct proc *curproc = myproc();
+	struct proc *curproc = myproc()->leader;
 
 	for(fd = 0; fd < NOFILE; fd++){
 		if(curproc->ofile[fd] == 0){
@@ -121,7 +121,7 @@ sys_close(void)
 
 	if(argfd(0, &fd, &f) < 0)
 		return -1;
-	myproc()->ofile[fd] = 0;
+	myproc()->leader->ofile[fd] = 0;
 	fileclose(f);
 	return 0;
 }
@@ -395,7 +395,7 @@ sys_chdir(void)
 {
 	char *path;
 	struct inode *ip;
-	struct proc *curproc = myproc();
+	struct proc *curproc = myproc()->leader;
 
 	begin_op();
 	if(argstr(0, &path) < 0 || (ip = namei(path)) == 0){
@@ -415,19 +415,16 @@ sys_chdir(void)
 	return 0;
 }
 
-int
-sys_exec(void)
+// Fetch the user's argv array at uargv into argv[MAXARG].
+static int
+fetchargv(uint uargv, char **argv)
 {
-	char *path, *argv[MAXARG];
 	int i;
-	uint uargv, uarg;
+	uint uarg;
 
-	if(argstr(0, &path) < 0 || argint(1, (int*)&uargv) < 0){
-		return -1;
-	}
-	memset(argv, 0, sizeof(argv));
+	memset(argv, 0, MAXARG*sizeof(argv[0]));
 	for(i=0;; i++){
-		if(i >= NELEM(argv))
+		if(i >= MAXARG)
 			return -1;
 		if(fetchint(uargv+4*i, (int*)&uarg) < 0)
 			return -1;
@@ -438,9 +435,41 @@ sys_exec(void)
 		if(fetchstr(uarg, &argv[i]) < 0)
 			return -1;
 	}
+	return 0;
+}
+
+int
+sys_exec(void)
+{
+	char *path, *argv[MAXARG];
+	uint uargv;
+
+	if(argstr(0, &path) < 0 || argint(1, (int*)&uargv) < 0){
+		return -1;
+	}
+	if(fetchargv(uargv, argv) < 0)
+		return -1;
 	return exec(path, argv);
 }
 
+int
+sys_spawn(void)
+{
+	char *path, *argv[MAXARG];
+	uint uargv;
+	int *fds, ufds;
+
+	if(argstr(0, &path) < 0 || argint(1, (int*)&uargv) < 0 ||
+	   argint(2, &ufds) < 0)
+		return -1;
+	if(fetchargv(uargv, argv) < 0)
+		return -1;
+	fds = 0;
+	if(ufds && argptr(2, (void*)&fds, NSPAWNFD*sizeof(int)) < 0)
+		return -1;
+	return spawn(path, argv, fds);
+}
+
 int
 sys_pipe(void)
 {
@@ -455,7 +484,7 @@ sys_pipe(void)
 	fd0 = -1;
 	if((fd0 = fdalloc(rf)) < 0 || (fd1 = fdalloc(wf)) < 0){
 		if(fd0 >= 0)
-			myproc()->ofile[fd0] = 0;
+			myproc()->leader->ofile[fd0] = 0;
 		fileclose(rf);
 		fileclose(wf);
 		return -1;
@@ -465,6 +494,22 @@ sys_pipe(void)
 	return 0;
 }
 
+int
+sys_ringsetup(void)
+{
+	return ringsetup();
+}
+
+int
+sys_ringenter(void)
+{
+	int n, min;
+
+	if(argint(0, &n) < 0 || argint(1, &min) < 0)
+		return -1;
+	return ringenter(n, min);
+}
+
 int
 sys_setkey(void)
 {
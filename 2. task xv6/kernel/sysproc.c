@@ -6,6 +6,12 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "proc.h"
+#include "lockstat.h"
+#include "irq.h"
+#include "clock.h"
+#include "sysstat.h"
+#include "bootstat.h"
+#include "tune.h"
 
 int
 sys_fork(void)
@@ -39,21 +45,149 @@ sys_kill(void)
 int
 sys_getpid(void)
 {
-	return myproc()->pid;
+	return myproc()->leader->pid;
 }
 
 int
 sys_sbrk(void)
 {
-	int addr;
 	int n;
 
 	if(argint(0, &n) < 0)
 		return -1;
-	addr = myproc()->sz;
-	if(growproc(n) < 0)
+	return growproc(n);
+}
+
+int
+sys_lockstat(void)
+{
+	int cmd, n;
+	struct lockstat *ls;
+
+	if(argint(0, &cmd) < 0 || argint(2, &n) < 0)
+		return -1;
+	if(argarray(1, (void*)&ls, n, sizeof(*ls)) < 0)
+		return -1;
+	return lockstatctl(cmd, ls, n);
+}
+
+int
+sys_sysstat(void)
+{
+	int cmd, n;
+	struct sysstat *ss;
+
+	if(argint(0, &cmd) < 0 || argint(2, &n) < 0)
+		return -1;
+	if(argarray(1, (void*)&ss, n, sizeof(*ss)) < 0)
+		return -1;
+	return sysstatctl(cmd, ss, n);
+}
+
+int
+sys_bootstat(void)
+{
+	int cmd, n;
+	struct bootstamp *bs;
+
+	if(argint(0, &cmd) < 0 || argint(2, &n) < 0)
+		return -1;
+	if(argarray(1, (void*)&bs, n, sizeof(*bs)) < 0)
+		return -1;
+	return bootstatctl(cmd, bs, n);
+}
+
+int
+sys_tune(void)
+{
+	int cmd, n;
+	struct tunable *t;
+
+	if(argint(0, &cmd) < 0 || argint(2, &n) < 0)
+		return -1;
+	if(argarray(1, (void*)&t, n, sizeof(*t)) < 0)
+		return -1;
+	return tunectl(cmd, t, n);
+}
+
+int
+sys_clockgettime(void)
+{
+	int clk;
+	struct timespec *ts;
+
+	if(argint(0, &clk) < 0 || argptr(1, (void*)&ts, sizeof(*ts)) < 0)
+		return -1;
+	return clockgettime(clk, ts);
+}
+
+int
+sys_irqroute(void)
+{
+	int irq, cpu;
+
+	if(argint(0, &irq) < 0 || argint(1, &cpu) < 0)
+		return -1;
+	return ioapicroute(irq, cpu);
+}
+
+int
+sys_irqstat(void)
+{
+	int n;
+	struct irqstat *st;
+
+	if(argint(1, &n) < 0)
+		return -1;
+	if(argarray(0, (void*)&st, n, sizeof(*st)) < 0)
+		return -1;
+	return irqstat(st, n);
+}
+
+int
+sys_clone(void)
+{
+	int fn, arg, stack;
+
+	if(argint(0, &fn) < 0 || argint(1, &arg) < 0 || argint(2, &stack) < 0)
+		return -1;
+	return clone((void(*)(void*))fn, (void*)arg, (char*)stack);
+}
+
+int
+sys_join(void)
+{
+	char **stack;
+	char *ustack;
+	int tid;
+
+	if(argptr(0, (void*)&stack, sizeof(*stack)) < 0)
+		return -1;
+	if((tid = join(&ustack)) >= 0)
+		*stack = ustack;
+	return tid;
+}
+
+int
+sys_futexwait(void)
+{
+	int *addr;
+	int val;
+
+	if(argptr(0, (void*)&addr, sizeof(*addr)) < 0 || argint(1, &val) < 0)
+		return -1;
+	return futexwait(addr, val);
+}
+
+int
+sys_futexwake(void)
+{
+	int *addr;
+	int n;
+
+	if(argptr(0, (void*)&addr, sizeof(*addr)) < 0 || argint(1, &n) < 0)
 		return -1;
-	return addr;
+	return futexwake(addr, n);
 }
 
 int
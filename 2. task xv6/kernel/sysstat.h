@@ -0,0 +1,18 @@
+#define SS_START 1  // Reset the counters and record every process
+#define SS_CHILD 2  // Reset and record only processes the caller creates
+#define SS_STOP  3  // Stop recording
+#define SS_READ  4  // Copy the counters out
+
+// Latency buckets: bucket i counts calls that took 2^i to
+// 2^(i+1)-1 cycles; the last one also takes everything longer.
+#define NSYSHIST 24
+
+// Counters for one system call, as read by sysstat().
+struct sysstat {
+	char name[12];
+	int num;              // System call number
+	uint calls;           // Times called
+	uint errors;          // Calls that returned a negative value
+	uint kcycles;         // Cycles spent in the call, in units of 1024
+	uint hist[NSYSHIST];  // Calls by log2 of cycles taken
+};
@@ -13,6 +13,7 @@ gatedesc idt[256];
 extern uint vectors[];  // in vectors.S: array of 256 entry pointers
 struct spinlock tickslock;
 uint ticks;
+extern void sysentry(void);  // in trapasm.S
 
 void
 tvinit(void)
@@ -35,16 +36,29 @@ idtinit(void)
 void
 trap(struct trapframe *tf)
 {
+	// sysenter leaves EFLAGS.TF alone, so a user who sets it
+	// single-steps into sysentry, still on the CPU's entry stack.
+	// Clear TF and let the system call go on.
+	if(tf->trapno == T_DEBUG && (tf->cs&3) == 0 && tf->eip == (uint)sysentry){
+		tf->eflags &= ~FL_TF;
+		return;
+	}
+
 	if(tf->trapno == T_SYSCALL){
 		if(myproc()->killed)
 			exit();
 		myproc()->tf = tf;
+		vmhold();
 		syscall();
+		vmrelease();
 		if(myproc()->killed)
 			exit();
 		return;
 	}
 
+	if(tf->trapno >= T_IRQ0 && tf->trapno < T_IRQ0 + NIRQ)
+		irqcount(tf->trapno - T_IRQ0);
+
 	switch(tf->trapno){
 	case T_IRQ0 + IRQ_TIMER:
 		if(cpuid() == 0){
@@ -53,6 +67,7 @@ trap(struct trapframe *tf)
 			wakeup(&ticks);
 			release(&tickslock);
 		}
+		rcupoll();
 		lapiceoi();
 		break;
 	case T_IRQ0 + IRQ_IDE:
@@ -70,6 +85,12 @@ trap(struct trapframe *tf)
 		uartintr();
 		lapiceoi();
 		break;
+	case T_TLBFLUSH:
+		// Another CPU changed a page table we may be using.
+		lcr3(rcr3());
+		mycpu()->tlbgen++;
+		lapiceoi();
+		break;
 	case T_IRQ0 + 7:
 	case T_IRQ0 + IRQ_SPURIOUS:
 		cprintf("cpu%d: spurious interrupt at %x:%x\n",
@@ -0,0 +1,97 @@
+// Boot-time tunables.
+//
+// The table sizes in param.h are defaults.  The kernel command
+// line from a multiboot loader can override them with name=value
+// words, as in make qemu-kernel BOOTARGS="nbuf=200 logsize=60".
+// Other words, such as the kernel path GRUB passes, are ignored.
+//
+// binit(), fileinit(), iinit() and userinit() size their tables
+// from these.  initlog() fits logsize and maxopblocks to the log
+// on disk and to the buffer cache, so the values tune shows are
+// the ones in effect.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "fs.h"
+#include "tune.h"
+
+int nbuf;         // Buffers in the disk block cache
+int ninode;       // Active i-nodes
+int nfile;        // Open files per system
+int logsize;      // Blocks in a log transaction; 0 uses the disk's log
+int maxopblocks;  // Blocks any FS op may write
+
+static struct {
+	char *name;
+	int *var;
+	int def, min, max;
+} tun[] = {
+	{ "nbuf",        &nbuf,        NBUF,        NBUF,        4096 },
+	{ "ninode",      &ninode,      NINODE,      16,          4096 },
+	{ "nfile",       &nfile,       NFILE,       NOFILE,      4096 },
+	{ "nproc",       &maxproc,     0,           4,           32768 },
+	{ "logsize",     &logsize,     0,           MAXOPBLOCKS, LOGMAX },
+	{ "maxopblocks", &maxopblocks, MAXOPBLOCKS, MAXOPBLOCKS, LOGMAX },
+};
+
+// Set the tunable called name[0..len) from the digits at s.
+static void
+set(char *name, int len, char *s)
+{
+	int i, v;
+
+	for(i = 0; i < NELEM(tun); i++)
+		if(strlen(tun[i].name) == len && strncmp(tun[i].name, name, len) == 0)
+			break;
+	if(i == NELEM(tun))
+		return;
+	for(v = 0; *s >= '0' && *s <= '9' && v <= tun[i].max; s++)
+		v = v*10 + *s - '0';
+	if((*s && *s != ' ') || v < tun[i].min || v > tun[i].max){
+		cprintf("tune: %s must be %d to %d\n", tun[i].name, tun[i].min, tun[i].max);
+		return;
+	}
+	*tun[i].var = v;
+}
+
+// Called from main() after mbinit(), before any table is sized.
+void
+tuneinit(void)
+{
+	char *p, *q;
+	int i;
+
+	for(i = 0; i < NELEM(tun); i++)
+		*tun[i].var = tun[i].def;
+	for(p = bootargs; *p; p = q){
+		if(*p == ' '){
+			q = p + 1;
+			continue;
+		}
+		for(q = p; *q && *q != ' ' && *q != '='; q++)
+			;
+		if(*q == '=')
+			set(p, q - p, q + 1);
+		while(*q && *q != ' ')
+			q++;
+	}
+}
+
+// Copy up to n tunables to t.  Returns the number copied.
+int
+tunectl(int cmd, struct tunable *t, int n)
+{
+	int i;
+
+	if(cmd != TN_READ)
+		return -1;
+	for(i = 0; i < n && i < NELEM(tun); i++, t++){
+		safestrcpy(t->name, tun[i].name, sizeof(t->name));
+		t->val = *tun[i].var;
+		t->def = tun[i].def;
+		t->min = tun[i].min;
+		t->max = tun[i].max;
+	}
+	return i;
+}
@@ -0,0 +1,9 @@
+#define TN_READ 1  // Copy the tunables out
+
+// One boot-time tunable, as read by tune().
+struct tunable {
+	char name[12];
+	int val;       // In effect
+	int def;       // If not on the command line; 0 sizes it at boot
+	int min, max;
+};
@@ -6,9 +6,11 @@
 #include "mmu.h"
 #include "proc.h"
 #include "elf.h"
+#include "traps.h"
 
 extern char data[];  // defined by kernel.ld
 pde_t *kpgdir;  // for use in scheduler()
+extern void sysentry(void);  // trapasm.S
 
 // Set up CPU's kernel segment descriptors.
 // Run once on entry on each CPU.
@@ -16,17 +18,48 @@ void
 seginit(void)
 {
 	struct cpu *c;
+	int apicid;
+	uint a, b, cx, d;
+
+	// %gs is not set up yet, so find this CPU by its APIC ID.
+	// APIC IDs are not guaranteed to be contiguous.
+	apicid = lapicid();
+	for(c = cpus; c < cpus+ncpu; c++)
+		if(c->apicid == apicid)
+			break;
+	if(c == cpus+ncpu)
+		panic("seginit: unknown apicid");
 
 	// Map "logical" addresses to virtual addresses using identity map.
 	// Cannot share a CODE descriptor for both kernel and user
 	// because it would have to have DPL_USR, but the CPU forbids
 	// an interrupt from CPL=0 to DPL=3.
-	c = &cpus[cpuid()];
 	c->gdt[SEG_KCODE] = SEG(STA_X|STA_R, 0, 0xffffffff, 0);
 	c->gdt[SEG_KDATA] = SEG(STA_W, 0, 0xffffffff, 0);
 	c->gdt[SEG_UCODE] = SEG(STA_X|STA_R, 0, 0xffffffff, DPL_USER);
 	c->gdt[SEG_UDATA] = SEG(STA_W, 0, 0xffffffff, DPL_USER);
+
+	// Map the per-CPU segment onto c for mycpu() and myproc().
+	c->self = c;
+	c->gdt[SEG_KCPU] = SEG(STA_W, c, sizeof(*c), 0);
+
 	lgdt(c->gdt, sizeof(c->gdt));
+	loadgs(SEG_KCPU << 3);
+
+	// Let user code enter the kernel with sysenter (see
+	// sysentry in trapasm.S).  The CPU loads %esp from the MSR,
+	// so point it at the top word of this CPU's entry stack,
+	// which holds &ts.esp0; switchuvm() keeps ts.esp0 at the top
+	// of the current process's kernel stack.  The rest of the
+	// entry stack takes the debug trap a user's EFLAGS.TF raises
+	// at sysentry (see trap).
+	cpuinfo(1, &a, &b, &cx, &d);
+	if(d & CPUID_SEP){
+		c->sysstack[NELEM(c->sysstack)-1] = (uint)&c->ts.esp0;
+		wrmsr(MSR_SYSENTER_CS, SEG_KCODE << 3);
+		wrmsr(MSR_SYSENTER_ESP, (uint)&c->sysstack[NELEM(c->sysstack)-1]);
+		wrmsr(MSR_SYSENTER_EIP, (uint)sysentry);
+	}
 }
 
 // Return the address of the PTE in page table pgdir
@@ -101,20 +134,24 @@ mappages(pde_t *pgdir, void *va, uint size, uint pa, int perm)
 // (directly addressable from end..P2V(PHYSTOP)).
 
 // This table defines the kernel's mappings, which are present in
-// every process's page table.
+// every process's page table.  They are identical everywhere, so
+// they are marked global and survive the %cr3 load of a switch.
 static struct kmap {
 	void *virt;
 	uint phys_start;
 	uint phys_end;
 	int perm;
 } kmap[] = {
-	{ (void*)KERNBASE, 0,             EXTMEM,    PTE_W}, // I/O space
-	{ (void*)KERNLINK, V2P(KERNLINK), V2P(data), 0},     // kern text+rodata
-	{ (void*)data,     V2P(data),     PHYSTOP,   PTE_W}, // kern data+memory
-	{ (void*)DEVSPACE, DEVSPACE,      0,         PTE_W}, // more devices
+	{ (void*)KERNBASE, 0,             EXTMEM,    PTE_W|PTE_G}, // I/O space
+	{ (void*)KERNLINK, V2P(KERNLINK), V2P(data), PTE_G},       // kern text+rodata
+	{ (void*)data,     V2P(data),     PHYSTOP,   PTE_W|PTE_G}, // kern data+memory
+	{ (void*)DEVSPACE, DEVSPACE,      0,         PTE_W|PTE_G}, // more devices
 };
 
 // Set up kernel part of a page table.
+// The kernel mappings never change after boot, so once kpgdir
+// exists every other page directory shares its page tables
+// rather than paying for a private copy of them.
 pde_t*
 setupkvm(void)
 {
@@ -124,6 +161,11 @@ setupkvm(void)
 	if((pgdir = (pde_t*)kalloc()) == 0)
 		return 0;
 	memset(pgdir, 0, PGSIZE);
+	if(kpgdir){
+		memmove(&pgdir[PDX(KERNBASE)], &kpgdir[PDX(KERNBASE)],
+		        (NPDENTRIES - PDX(KERNBASE)) * sizeof(pde_t));
+		return pgdir;
+	}
 	if (P2V(PHYSTOP) > (void*)DEVSPACE)
 		panic("PHYSTOP too high");
 	for(k = kmap; k < &kmap[NELEM(kmap)]; k++)
@@ -135,6 +177,30 @@ setupkvm(void)
 	return pgdir;
 }
 
+// Return a kernel address for the size bytes of physical memory
+// at pa.  Memory above PHYSTOP, such as the ACPI tables firmware
+// leaves at the top of RAM, is mapped into kpgdir above KMAPBASE.
+// Only for use at boot, before setupkvm() copies kpgdir for the
+// first process, so that every page table has the mapping.
+void*
+kmapphys(uint pa, uint size)
+{
+	static uint next = KMAPBASE;
+	uint a, va;
+
+	if(pa + size <= PHYSTOP)
+		return P2V(pa);
+	a = PGROUNDDOWN(pa);
+	size = PGROUNDUP(pa + size) - a;
+	if(next + size > DEVSPACE || next + size < next)
+		panic("kmapphys");
+	va = next;
+	if(mappages(kpgdir, (void*)va, size, a, PTE_W|PTE_G) < 0)
+		panic("kmapphys: out of memory");
+	next += size;
+	return (void*)(va + pa - a);
+}
+
 // Allocate one page table for the machine for the kernel address
 // space for scheduler processes.
 void
@@ -177,6 +243,52 @@ switchuvm(struct proc *p)
 	popcli();
 }
 
+// Make every other CPU drop TLB entries it may hold for pgdir.
+// Only CPUs currently running a thread on pgdir can have any;
+// a CPU that switches to it later reloads %cr3 anyway.
+// Call with no locks held, since the targets must be able to
+// take the interrupt.
+void
+tlbshootdown(pde_t *pgdir)
+{
+	struct cpu *c, *me;
+	struct proc *p;
+	uint gen[NCPU];
+	uint64 sent;
+
+	__sync_synchronize();  // PTE updates before reading c->proc
+
+	pushcli();
+	me = mycpu();
+	sent = 0;
+	for(c = cpus; c < cpus+ncpu; c++){
+		p = c->proc;
+		if(c == me || p == 0 || p->pgdir != pgdir)
+			continue;
+		gen[c-cpus] = c->tlbgen;
+		lapicipi(c->apicid, T_TLBFLUSH);
+		sent |= (uint64)1 << (c-cpus);
+	}
+	popcli();
+
+	for(c = cpus; c < cpus+ncpu; c++)
+		if(sent & (uint64)1 << (c-cpus))
+			while(c->tlbgen == gen[c-cpus])
+				;
+}
+
+// Map the kernel page mem at va, above USERTOP, with permissions
+// perm|PTE_U.  Like any user page, freevm() will free it, unless
+// perm includes PTE_NOFREE; fork() shares such pages instead of
+// copying them.
+int
+mapupage(pde_t *pgdir, uint va, char *mem, int perm)
+{
+	if(va < USERTOP || va >= KERNBASE)
+		panic("mapupage");
+	return mappages(pgdir, (char*)va, PGSIZE, V2P(mem), perm|PTE_U);
+}
+
 // Load the initcode into address 0 of pgdir.
 // sz must be less than a page.
 void
@@ -224,7 +336,7 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
 	char *mem;
 	uint a;
 
-	if(newsz >= KERNBASE)
+	if(newsz > USERTOP)
 		return 0;
 	if(newsz < oldsz)
 		return oldsz;
@@ -271,15 +383,52 @@ deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
 			if(pa == 0)
 				panic("kfree");
 			char *v = P2V(pa);
-			kfree(v);
+			if(!(*pte & PTE_NOFREE))
+				kfree(v);
 			*pte = 0;
 		}
 	}
 	return newsz;
 }
 
+// Like deallocuvm, but for a page table that threads on other
+// CPUs may be using.  Pages are unmapped a batch at a time and
+// only handed back to kalloc once tlbshootdown() guarantees that
+// no CPU still holds a stale TLB entry for them.
+int
+deallocuvmsync(pde_t *pgdir, uint oldsz, uint newsz)
+{
+	char *batch[32];
+	pte_t *pte;
+	uint a, pa;
+	int i, n;
+
+	if(newsz >= oldsz)
+		return oldsz;
+
+	a = PGROUNDUP(newsz);
+	while(a < oldsz){
+		for(n = 0; a < oldsz && n < NELEM(batch); a += PGSIZE){
+			pte = walkpgdir(pgdir, (char*)a, 0);
+			if(!pte)
+				a = PGADDR(PDX(a) + 1, 0, 0) - PGSIZE;
+			else if((*pte & PTE_P) != 0){
+				pa = PTE_ADDR(*pte);
+				if(pa == 0)
+					panic("kfree");
+				batch[n++] = P2V(pa);
+				*pte = 0;
+			}
+		}
+		tlbshootdown(pgdir);
+		for(i = 0; i < n; i++)
+			kfree(batch[i]);
+	}
+	return newsz;
+}
+
 // Free a page table and all the physical memory pages
-// in the user part.
+// in the user part.  The kernel part is shared with kpgdir.
 void
 freevm(pde_t *pgdir)
 {
@@ -288,7 +437,7 @@ freevm(pde_t *pgdir)
 	if(pgdir == 0)
 		panic("freevm: no pgdir");
 	deallocuvm(pgdir, KERNBASE, 0);
-	for(i = 0; i < NPDENTRIES; i++){
+	for(i = 0; i < PDX(KERNBASE); i++){
 		if(pgdir[i] & PTE_P){
 			char * v = P2V(PTE_ADDR(pgdir[i]));
 			kfree(v);
@@ -337,6 +486,12 @@ copyuvm(pde_t *pgdir, uint sz)
 			goto bad;
 		}
 	}
+	for(i = USERTOP; i < KERNBASE; i += PGSIZE){
+		pte = walkpgdir(pgdir, (void *) i, 0);
+		if(pte && (*pte & PTE_P) && (*pte & PTE_NOFREE))
+			if(mappages(d, (void*)i, PGSIZE, PTE_ADDR(*pte), PTE_FLAGS(*pte)) < 0)
+				goto bad;
+	}
 	return d;
 
 bad:
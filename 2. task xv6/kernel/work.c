@@ -0,0 +1,120 @@
+// Deferred interrupt work.
+//
+// An interrupt handler should only acknowledge its device and
+// call queuework(); the data movement and wakeups then happen in
+// a kernel worker thread with interrupts enabled, rather than
+// holding off every other interrupt on that CPU.  There is one
+// worker per CPU, and work goes on the queue of the CPU that took
+// the interrupt.
+//
+// A work item is queued at most once at a time, but if its
+// interrupt moves to another CPU it may run on two workers at
+// once, so its function must check for itself whether there is
+// anything left to do.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "work.h"
+
+struct workq {
+	struct spinlock lock;
+	struct work *head;   // Oldest queued work
+	struct work **tail;
+};
+
+static struct workq *workq;  // One per CPU
+
+void
+initwork(struct work *w, void (*fn)(void))
+{
+	w->next = 0;
+	w->queued = 0;
+	w->fn = fn;
+}
+
+// Queue w for this CPU's worker, unless it is already queued.
+// Called from interrupt handlers.
+void
+queuework(struct work *w)
+{
+	struct workq *q;
+
+	if(__sync_lock_test_and_set(&w->queued, 1))
+		return;
+	pushcli();
+	q = &workq[cpuid()];
+	popcli();
+
+	acquire(&q->lock);
+	w->next = 0;
+	*q->tail = w;
+	q->tail = &w->next;
+	wakeup(q);
+	release(&q->lock);
+}
+
+static void
+worker(void *arg)
+{
+	struct workq *q = arg;
+	struct work *w;
+
+	for(;;){
+		acquire(&q->lock);
+		while((w = q->head) == 0)
+			sleep(q, &q->lock);
+		if((q->head = w->next) == 0)
+			q->tail = &q->head;
+		release(&q->lock);
+
+		// Clear queued first, so that an interrupt arriving
+		// while fn runs queues it again.
+		__sync_lock_release(&w->queued);
+		w->fn();
+	}
+}
+
+// Set up the per-CPU queues, before any interrupt can call
+// queuework().  Work queued before workstart() waits for it.
+void
+workinit(void)
+{
+	struct workq *q;
+	int n;
+
+	n = PGROUNDUP(ncpu * sizeof(*workq)) / PGSIZE;
+	if((workq = (struct workq*)kallocn(n)) == 0)
+		panic("workinit: no memory");
+	memset(workq, 0, n * PGSIZE);
+	for(q = workq; q < workq+ncpu; q++){
+		initlock(&q->lock, "workq");
+		q->tail = &q->head;
+	}
+}
+
+// Start one worker thread per CPU, once the process table
+// can hold them.
+void
+workstart(void)
+{
+	struct workq *q;
+	char name[16];
+	int i, n;
+
+	safestrcpy(name, "kworker", sizeof(name));
+	for(q = workq; q < workq+ncpu; q++){
+		i = q - workq;
+		n = 7;
+		if(i >= 10)
+			name[n++] = '0' + i/10;
+		name[n++] = '0' + i%10;
+		name[n] = 0;
+		if(kthread(name, worker, q) < 0)
+			panic("workstart");
+	}
+}
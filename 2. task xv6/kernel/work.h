@@ -0,0 +1,6 @@
+// Deferred interrupt work, run by a worker thread (see work.c).
+struct work {
+	struct work *next;  // Next on a worker's queue
+	uint queued;        // Is it on a queue?
+	void (*fn)(void);
+};
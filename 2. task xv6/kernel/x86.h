@@ -101,6 +101,28 @@ loadgs(ushort v)
 	asm volatile("movw %0, %%gs" : : "r" (v));
 }
 
+static inline void
+cpuinfo(uint op, uint *eax, uint *ebx, uint *ecx, uint *edx)
+{
+	asm volatile("cpuid" : "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx)
+	                     : "a" (op));
+}
+
+static inline uint64
+rdmsr(uint msr)
+{
+	uint64 val;
+
+	asm volatile("rdmsr" : "=A" (val) : "c" (msr));
+	return val;
+}
+
+static inline void
+wrmsr(uint msr, uint64 val)
+{
+	asm volatile("wrmsr" : : "c" (msr), "A" (val));
+}
+
 static inline void
 cli(void)
 {
@@ -126,6 +148,22 @@ xchg(volatile uint *addr, uint newval)
 	return result;
 }
 
+// Spin-wait hint: saves power and avoids a memory-order
+// pipeline flush when the awaited store arrives.
+static inline void
+pause(void)
+{
+	asm volatile("pause");
+}
+
+static inline uint64
+rdtsc(void)
+{
+	uint64 val;
+	asm volatile("rdtsc" : "=A" (val));
+	return val;
+}
+
 static inline uint
 rcr2(void)
 {
@@ -140,6 +178,14 @@ lcr3(uint val)
 	asm volatile("movl %0,%%cr3" : : "r" (val));
 }
 
+static inline uint
+rcr3(void)
+{
+	uint val;
+	asm volatile("movl %%cr3,%0" : "=r" (val));
+	return val;
+}
+
 // Layout of the trap frame built on the stack by the
 // hardware and by trapasm.S, and passed to trap().
 struct trapframe {
@@ -0,0 +1,49 @@
+// Show where boot time went: each step of startup, when it
+// finished and how long it took since the step before.
+// Usage: bootstat
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/memlayout.h"
+#include "kernel/clock.h"
+#include "kernel/bootstat.h"
+#include "user.h"
+
+struct bootstamp bs[NBOOTSTAMP];
+char pad[] = "            ";
+
+// Microseconds in n TSC cycles at khz, stopping at 0x7fffffff
+// (about 35 minutes) before divl would fault.
+uint
+us(uint64 n, uint khz)
+{
+	uint q, rem;
+
+	n *= 1000;
+	if((n >> 32) >= khz)
+		return 0x7fffffff;
+	asm("divl %4" : "=a" (q), "=d" (rem) : "a" ((uint)n), "d" ((uint)(n >> 32)), "r" (khz));
+	return q > 0x7fffffff ? 0x7fffffff : q;
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct timepage *tp = (struct timepage*)TIMEVA;
+	uint khz;
+	int i, n;
+
+	khz = tp->tschz / 1000;
+	if((n = bootstat(BS_READ, bs, NBOOTSTAMP)) <= 0 || khz == 0){
+		fprintf(2, "bootstat: no boot stamps\n");
+		exit();
+	}
+
+	// Pad names to a column; printf has no field widths.
+	printf("step         at-us step-us\n");
+	for(i = 0; i < n; i++)
+		printf("%s%s %d %d\n", bs[i].name, pad + strlen(bs[i].name),
+		       us(bs[i].tsc - bs[0].tsc, khz),
+		       i > 0 ? us(bs[i].tsc - bs[i-1].tsc, khz) : 0);
+	exit();
+}
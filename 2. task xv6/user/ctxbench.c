@@ -0,0 +1,50 @@
+// Context-switch latency: two processes bounce a byte over a
+// pair of pipes, so every transfer is a sleep and a wakeup.
+// Usage: ctxbench [round trips]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user.h"
+
+int
+main(int argc, char *argv[])
+{
+	int p1[2], p2[2];
+	int i, n, pid, t;
+	char c;
+
+	n = 20000;
+	if(argc > 1)
+		n = atoi(argv[1]);
+	if(pipe(p1) < 0 || pipe(p2) < 0){
+		printf("ctxbench: pipe failed\n");
+		exit();
+	}
+	if((pid = fork()) < 0){
+		printf("ctxbench: fork failed\n");
+		exit();
+	}
+	if(pid == 0){
+		for(i = 0; i < n; i++){
+			if(read(p1[0], &c, 1) != 1)
+				break;
+			write(p2[1], &c, 1);
+		}
+		exit();
+	}
+
+	c = 'x';
+	t = uptime();
+	for(i = 0; i < n; i++){
+		write(p1[1], &c, 1);
+		read(p2[0], &c, 1);
+	}
+	t = uptime() - t;
+	wait();
+
+	printf("ctxbench: %d round trips in %d ticks", n, t);
+	if(t > 0)
+		printf(" (%d switches per tick)", 2*n / t);
+	printf("\n");
+	exit();
+}
@@ -1,11 +1,12 @@
 // Test that fork fails gracefully.
-// Tiny executable so that the limit can be filling the proc table.
+// Tiny executable so that the limit can be filling the proc table,
+// which is sized from memory at boot.
 
 #include "kernel/types.h"
 #include "kernel/stat.h"
 #include "user.h"
 
-#define N  1000
+#define N  100000
 
 // forktest is not linked against printf.o, so we have our own.
 void
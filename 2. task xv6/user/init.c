@@ -4,6 +4,7 @@
 #include "kernel/stat.h"
 #include "user.h"
 #include "kernel/fcntl.h"
+#include "kernel/bootstat.h"
 
 char *argv[] = { "sh", 0 };
 
@@ -11,6 +12,7 @@ int
 main(void)
 {
 	int pid, wpid;
+	struct bootstamp bs;
 
 	if(getpid() != 1){
 		fprintf(2, "init: already running\n");
@@ -24,16 +26,15 @@ main(void)
 	dup(0);  // stdout
 	dup(0);  // stderr
 
+	// The last step of boot, for bootstat.
+	strcpy(bs.name, "sh");
+	bootstat(BS_MARK, &bs, 1);
+
 	for(;;){
 		printf("init: starting sh\n");
-		pid = fork();
+		pid = spawn("/bin/sh", argv, 0);
 		if(pid < 0){
-			printf("init: fork failed\n");
-			exit();
-		}
-		if(pid == 0){
-			exec("/bin/sh", argv);
-			printf("init: exec sh failed\n");
+			printf("init: spawn sh failed\n");
 			exit();
 		}
 		while((wpid=wait()) >= 0 && wpid != pid)
@@ -0,0 +1,62 @@
+// Show and steer interrupt lines.
+// Usage: irq               list routes and per-CPU counts
+//        irq IRQ CPU       send IRQ to CPU
+//        irq IRQ rr        rotate IRQ among all CPUs
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "kernel/irq.h"
+#include "user.h"
+
+struct irqstat st[NIRQ];
+
+int
+main(int argc, char *argv[])
+{
+	int i, j, n, cpu, any, ncol;
+
+	if(argc == 3){
+		cpu = strcmp(argv[2], "rr") == 0 ? IRQ_RR : atoi(argv[2]);
+		if(irqroute(atoi(argv[1]), cpu) < 0){
+			fprintf(2, "irq: cannot route %s to %s\n", argv[1], argv[2]);
+			exit();
+		}
+		exit();
+	}
+	if(argc != 1){
+		fprintf(2, "usage: irq [irq cpu|rr]\n");
+		exit();
+	}
+
+	// Only show CPUs up to the last one that took or is sent
+	// any interrupt.
+	n = irqstat(st, NIRQ);
+	ncol = 1;
+	for(i = 0; i < n; i++){
+		if(st[i].route >= ncol)
+			ncol = st[i].route + 1;
+		for(j = ncol; j < NCPU; j++)
+			if(st[i].count[j])
+				ncol = j + 1;
+	}
+
+	printf("irq route counts by cpu\n");
+	for(i = 0; i < n; i++){
+		any = st[i].route != IRQ_OFF;
+		for(j = 0; j < NCPU; j++)
+			any |= st[i].count[j] != 0;
+		if(!any)
+			continue;
+		if(st[i].route == IRQ_OFF)
+			printf("%d off  ", i);
+		else if(st[i].route == IRQ_RR)
+			printf("%d rr   ", i);
+		else
+			printf("%d cpu%d", i, st[i].route);
+		for(j = 0; j < ncol; j++)
+			printf(" %d", st[i].count[j]);
+		printf("\n");
+	}
+	exit();
+}
@@ -0,0 +1,38 @@
+// Spinlock contention: n processes, one per CPU, each make a
+// stream of uptime() calls, all of which take tickslock.
+// Usage: lockbench [nproc [calls]]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user.h"
+
+int
+main(int argc, char *argv[])
+{
+	int i, j, n, calls, t;
+
+	n = 8;
+	calls = 100000;
+	if(argc > 1)
+		n = atoi(argv[1]);
+	if(argc > 2)
+		calls = atoi(argv[2]);
+
+	t = uptime();
+	for(i = 0; i < n; i++){
+		if(fork() == 0){
+			for(j = 0; j < calls; j++)
+				uptime();
+			exit();
+		}
+	}
+	for(i = 0; i < n; i++)
+		wait();
+	t = uptime() - t;
+
+	printf("lockbench: %d procs x %d acquires in %d ticks", n, calls, t);
+	if(t > 0)
+		printf(" (%d per tick)", n * calls / t);
+	printf("\n");
+	exit();
+}
@@ -0,0 +1,43 @@
+// Report kernel lock contention around a workload.
+// Usage: lockstat [command [args...]]
+// With a command, reset the counters, run it, and report.
+// Without one, report what has been recorded so far.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/lockstat.h"
+#include "user.h"
+
+#define NLS 64
+
+struct lockstat ls[NLS];
+char pad[] = "                ";
+
+int
+main(int argc, char *argv[])
+{
+	char path[32];
+	int i, n, pid;
+
+	if(argc > 1){
+		strcpy(path, "/bin/");
+		safestrcpy(path + 5, argv[1], sizeof(path) - 5);
+		lockstat(LS_START, 0, 0);
+		if((pid = spawn(path, argv + 1, 0)) < 0){
+			lockstat(LS_STOP, 0, 0);
+			fprintf(2, "lockstat: cannot run %s\n", path);
+			exit();
+		}
+		while(wait() != pid)
+			;
+		lockstat(LS_STOP, 0, 0);
+	}
+
+	// Pad names to a column; printf has no field widths.
+	n = lockstat(LS_READ, ls, NLS);
+	printf("name             acquires contended wait-kcycles max-hold\n");
+	for(i = 0; i < n; i++)
+		printf("%s%s %d %d %d %d\n", ls[i].name, pad + strlen(ls[i].name),
+		       ls[i].acquires, ls[i].contended, ls[i].waitkcycles, ls[i].maxhold);
+	exit();
+}
@@ -0,0 +1,46 @@
+// Fill the process table with sleeping processes.
+// Each child blocks reading a pipe that the parent holds open,
+// so all of them are alive at once; closing the pipe releases
+// them.  Usage: procstress [n]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user.h"
+
+int
+main(int argc, char *argv[])
+{
+	int fds[2], i, n, pid, t0;
+	char c;
+
+	n = 3000;
+	if(argc > 1)
+		n = atoi(argv[1]);
+	if(pipe(fds) < 0){
+		printf("procstress: pipe failed\n");
+		exit();
+	}
+
+	t0 = uptime();
+	for(i = 0; i < n; i++){
+		if((pid = fork()) < 0)
+			break;
+		if(pid == 0){
+			close(fds[1]);
+			read(fds[0], &c, 1);
+			exit();
+		}
+	}
+	printf("procstress: %d sleeping processes in %d ticks\n", i, uptime() - t0);
+
+	t0 = uptime();
+	close(fds[0]);
+	close(fds[1]);
+	for(n = i; i > 0; i--)
+		if(wait() < 0){
+			printf("procstress: wait stopped early\n");
+			exit();
+		}
+	printf("procstress: reaped %d in %d ticks\n", n, uptime() - t0);
+	exit();
+}
@@ -0,0 +1,137 @@
+// Write and read back a file in small records, once with a
+// system call per record and once through the submission ring
+// in batches, and check that both produce the same data.
+// Usage: ringbench [records]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "kernel/ring.h"
+#include "user.h"
+
+#define RECSIZE 32
+#define BATCH   32
+
+struct ring *r;
+char buf[BATCH][RECSIZE];
+
+void
+fill(char *p, int i)
+{
+	int j;
+
+	for(j = 0; j < RECSIZE; j++)
+		p[j] = 'a' + (i + j) % 26;
+}
+
+int
+check(char *p, int i)
+{
+	int j;
+
+	for(j = 0; j < RECSIZE; j++)
+		if(p[j] != 'a' + (i + j) % 26)
+			return 0;
+	return 1;
+}
+
+// Queue one operation on record i.
+void
+submit(int op, int fd, int i, char *p)
+{
+	struct sqe *e;
+
+	e = &r->sq[r->sqtail % RINGSQ];
+	e->op = op;
+	e->fd = fd;
+	e->addr = (uint)p;
+	e->n = RECSIZE;
+	e->off = i * RECSIZE;
+	e->data = i;
+	r->sqtail++;
+}
+
+// Submit everything queued, wait for all of it, and check it.
+void
+complete(int n)
+{
+	struct cqe *c;
+
+	if(ringenter(n, n) != n){
+		printf("ringbench: ringenter failed\n");
+		exit();
+	}
+	while(n-- > 0){
+		c = &r->cq[r->cqhead % RINGCQ];
+		if(c->res != RECSIZE){
+			printf("ringbench: record %d: res %d\n", c->data, c->res);
+			exit();
+		}
+		r->cqhead++;
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	int fd, i, j, n, t;
+
+	n = 2048;
+	if(argc > 1)
+		n = atoi(argv[1]);
+
+	// One write() per record.
+	unlink("ringbench.tmp");
+	if((fd = open("ringbench.tmp", O_CREATE|O_RDWR)) < 0){
+		printf("ringbench: cannot create file\n");
+		exit();
+	}
+	t = uptime();
+	for(i = 0; i < n; i++){
+		fill(buf[0], i);
+		if(write(fd, buf[0], RECSIZE) != RECSIZE){
+			printf("ringbench: write failed\n");
+			exit();
+		}
+	}
+	printf("write: %d records, %d traps, %d ticks\n", n, n, uptime() - t);
+	close(fd);
+
+	// The same records through the ring, BATCH per trap.
+	if((r = ringsetup()) == (struct ring*)-1){
+		printf("ringbench: ringsetup failed\n");
+		exit();
+	}
+	unlink("ringbench.tmp");
+	if((fd = open("ringbench.tmp", O_CREATE|O_RDWR)) < 0){
+		printf("ringbench: cannot create file\n");
+		exit();
+	}
+	t = uptime();
+	for(i = 0; i < n; i += BATCH){
+		for(j = 0; j < BATCH && i+j < n; j++){
+			fill(buf[j], i+j);
+			submit(RING_WRITE, fd, i+j, buf[j]);
+		}
+		complete(j);
+	}
+	printf("ring write: %d records, %d traps, %d ticks\n",
+	       n, (n + BATCH-1) / BATCH, uptime() - t);
+
+	// Read it back through the ring and check it.
+	t = uptime();
+	for(i = 0; i < n; i += BATCH){
+		for(j = 0; j < BATCH && i+j < n; j++)
+			submit(RING_READ, fd, i+j, buf[j]);
+		complete(j);
+		for(j = 0; j < BATCH && i+j < n; j++)
+			if(!check(buf[j], i+j)){
+				printf("ringbench: record %d corrupt\n", i+j);
+				exit();
+			}
+	}
+	printf("ring read: %d records, %d ticks\n", n, uptime() - t);
+	close(fd);
+	unlink("ringbench.tmp");
+	exit();
+}
@@ -54,6 +54,7 @@ struct backcmd {
 int fork1(void);  // Fork but panics on failure.
 void panic(char*);
 struct cmd *parsecmd(char*);
+void freecmd(struct cmd*);
 
 // Execute cmd.  Never returns.
 void
@@ -135,6 +136,87 @@ runcmd(struct cmd *cmd)
 	exit();
 }
 
+// Can cmd run without a forked copy of the shell?  True for
+// a program with redirections, or a pipeline of those.
+int
+simplecmd(struct cmd *cmd)
+{
+	struct pipecmd *pcmd;
+	struct redircmd *rcmd;
+
+	switch(cmd->type){
+	case EXEC:
+		return 1;
+	case REDIR:
+		rcmd = (struct redircmd*)cmd;
+		return rcmd->fd < 3 && simplecmd(rcmd->cmd);
+	case PIPE:
+		pcmd = (struct pipecmd*)cmd;
+		return simplecmd(pcmd->left) && simplecmd(pcmd->right);
+	}
+	return 0;
+}
+
+// Start a simple command with spawn(), its fds 0-2 taken from
+// the shell's fds[0-2].  Redirection files and pipes are opened
+// here, handed over, and closed again.  Returns the number of
+// processes started, each of which must be waited for.
+int
+spawncmd(struct cmd *cmd, int *fds)
+{
+	int p[2], fd, save, n;
+	char binpath[BINPATHLEN];
+	struct execcmd *ecmd;
+	struct pipecmd *pcmd;
+	struct redircmd *rcmd;
+
+	switch(cmd->type){
+	case EXEC:
+		ecmd = (struct execcmd*)cmd;
+		if(ecmd->argv[0] == 0)
+			return 0;
+		strcpy(binpath, "/bin/");
+		safestrcpy(binpath + 5, ecmd->argv[0], 14);
+		if(spawn(binpath, ecmd->argv, fds) < 0){
+			fprintf(2, "exec %s failed\n", binpath);
+			return 0;
+		}
+		return 1;
+
+	case REDIR:
+		rcmd = (struct redircmd*)cmd;
+		if((fd = open(rcmd->file, rcmd->mode)) < 0){
+			fprintf(2, "open %s failed\n", rcmd->file);
+			return 0;
+		}
+		save = fds[rcmd->fd];
+		fds[rcmd->fd] = fd;
+		n = spawncmd(rcmd->cmd, fds);
+		fds[rcmd->fd] = save;
+		close(fd);
+		return n;
+
+	case PIPE:
+		pcmd = (struct pipecmd*)cmd;
+		if(pipe(p) < 0){
+			fprintf(2, "pipe failed\n");
+			return 0;
+		}
+		save = fds[1];
+		fds[1] = p[1];
+		n = spawncmd(pcmd->left, fds);
+		fds[1] = save;
+		close(p[1]);
+		save = fds[0];
+		fds[0] = p[0];
+		n += spawncmd(pcmd->right, fds);
+		fds[0] = save;
+		close(p[0]);
+		return n;
+	}
+	return 0;
+}
+
 int
 getcmd(char *buf, int nbuf)
 {
@@ -150,7 +232,9 @@ int
 main(void)
 {
 	static char buf[100];
-	int fd;
+	int fd, n;
+	int fds[3];
+	struct cmd *cmd;
 
 	// Ensure that three file descriptors are open.
 	while((fd = open("/dev/console", O_RDWR)) >= 0){
@@ -169,9 +253,21 @@ main(void)
 				fprintf(2, "cannot cd %s\n", buf+3);
 			continue;
 		}
-		if(fork1() == 0)
-			runcmd(parsecmd(buf));
-		wait();
+		if((cmd = parsecmd(buf)) == 0)
+			continue;
+		if(simplecmd(cmd)){
+			// No need to copy the shell just to replace it.
+			fds[0] = 0;
+			fds[1] = 1;
+			fds[2] = 2;
+			for(n = spawncmd(cmd, fds); n > 0; n--)
+				wait();
+		} else {
+			if(fork1() == 0)
+				runcmd(cmd);
+			wait();
+		}
+		freecmd(cmd);
 	}
 	exit();
 }
@@ -260,7 +356,57 @@ backcmd(struct cmd *subcmd)
 	cmd->cmd = subcmd;
 	return (struct cmd*)cmd;
 }
+void
+freecmd(struct cmd *cmd)
+{
+	struct backcmd *bcmd;
+	struct listcmd *lcmd;
+	struct pipecmd *pcmd;
+	struct redircmd *rcmd;
+
+	if(cmd == 0)
+		return;
+
+	switch(cmd->type){
+	case REDIR:
+		rcmd = (struct redircmd*)cmd;
+		freecmd(rcmd->cmd);
+		break;
+
+	case PIPE:
+		pcmd = (struct pipecmd*)cmd;
+		freecmd(pcmd->left);
+		freecmd(pcmd->right);
+		break;
+
+	case LIST:
+		lcmd = (struct listcmd*)cmd;
+		freecmd(lcmd->left);
+		freecmd(lcmd->right);
+		break;
+
+	case BACK:
+		bcmd = (struct backcmd*)cmd;
+		freecmd(bcmd->cmd);
+		break;
+	}
+	free(cmd);
+}
+
 // Parsing
+//
+// The shell parses each line itself now, so a syntax error
+// must not exit: it is reported and parsecmd() returns 0.
+
+int syntaxerr;
+
+void
+badsyntax(char *msg)
+{
+	if(!syntaxerr)
+		fprintf(2, "%s\n", msg);
+	syntaxerr = 1;
+}
 
 char whitespace[] = " \t\r\n\v";
 char symbols[] = "<|>&;()";
@@ -334,11 +480,16 @@ parsecmd(char *s)
 	struct cmd *cmd;
 
 	es = s + strlen(s);
+	syntaxerr = 0;
 	cmd = parseline(&s, es);
 	peek(&s, es, "");
-	if(s != es){
+	if(s != es && !syntaxerr){
 		fprintf(2, "leftovers: %s\n", s);
-		panic("syntax");
+		badsyntax("syntax");
+	}
+	if(syntaxerr){
+		freecmd(cmd);
+		return 0;
 	}
 	nulterminate(cmd);
 	return cmd;
@@ -382,8 +533,10 @@ parseredirs(struct cmd *cmd, char **ps, char *es)
 
 	while(peek(ps, es, "<>")){
 		tok = gettoken(ps, es, 0, 0);
-		if(gettoken(ps, es, &q, &eq) != 'a')
-			panic("missing file for redirection");
+		if(gettoken(ps, es, &q, &eq) != 'a'){
+			badsyntax("missing file for redirection");
+			break;
+		}
 		switch(tok){
 		case '<':
 			cmd = redircmd(cmd, q, eq, O_RDONLY, 0);
@@ -408,8 +561,10 @@ parseblock(char **ps, char *es)
 		panic("parseblock");
 	gettoken(ps, es, 0, 0);
 	cmd = parseline(ps, es);
-	if(!peek(ps, es, ")"))
-		panic("syntax - missing )");
+	if(!peek(ps, es, ")")){
+		badsyntax("syntax - missing )");
+		return cmd;
+	}
 	gettoken(ps, es, 0, 0);
 	cmd = parseredirs(cmd, ps, es);
 	return cmd;
@@ -434,13 +589,17 @@ parseexec(char **ps, char *es)
 	while(!peek(ps, es, "|)&;")){
 		if((tok=gettoken(ps, es, &q, &eq)) == 0)
 			break;
-		if(tok != 'a')
-			panic("syntax");
+		if(tok != 'a'){
+			badsyntax("syntax");
+			break;
+		}
+		if(argc >= MAXARGS-1){
+			badsyntax("too many args");
+			break;
+		}
 		cmd->argv[argc] = q;
 		cmd->eargv[argc] = eq;
 		argc++;
-		if(argc >= MAXARGS)
-			panic("too many args");
 		ret = parseredirs(ret, ps, es);
 	}
 	cmd->argv[argc] = 0;
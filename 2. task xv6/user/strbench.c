@@ -0,0 +1,151 @@
+// Compare the library's memset, memmove, memcmp and strlen with
+// byte-at-a-time loops, by buffer size, and check their results.
+// Usage: strbench [kbytes per test]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/clock.h"
+#include "user.h"
+
+#define MAXSIZE 65536
+
+char a[MAXSIZE+4], b[MAXSIZE+4];
+int sizes[] = { 16, 64, 256, 1024, 4096, MAXSIZE };
+volatile int sink;
+
+void*
+bytememset(void *dst, int c, uint n)
+{
+	char *d = dst;
+
+	while(n-- > 0)
+		*d++ = c;
+	return dst;
+}
+
+void*
+bytememmove(void *dst, const void *src, int n)
+{
+	char *d = dst;
+	const char *s = src;
+
+	while(n-- > 0)
+		*d++ = *s++;
+	return dst;
+}
+
+int
+bytememcmp(const void *v1, const void *v2, uint n)
+{
+	const uchar *s1 = v1, *s2 = v2;
+
+	for(; n > 0; n--, s1++, s2++)
+		if(*s1 != *s2)
+			return *s1 - *s2;
+	return 0;
+}
+
+uint
+bytestrlen(const char *s)
+{
+	int n;
+
+	for(n = 0; s[n]; n++)
+		;
+	return n;
+}
+
+uint
+usdiff(struct timespec *a, struct timespec *b)
+{
+	return (b->sec - a->sec) * 1000000 + b->nsec/1000 - a->nsec/1000;
+}
+
+// Run one routine over size-byte buffers, total bytes in all,
+// and return MB/s.  Offset 1 makes the copies unaligned.
+uint
+run(int which, int byte, int size, uint total)
+{
+	struct timespec t0, t1;
+	uint i, n, us;
+
+	n = total / size;
+	clockgettime(CLOCK_MONOTONIC, &t0);
+	for(i = 0; i < n; i++){
+		switch(which){
+		case 0:
+			(byte ? bytememset : memset)(a, i, size);
+			break;
+		case 1:
+			(byte ? bytememmove : memmove)(b + 1, a, size);
+			break;
+		case 2:
+			sink = (byte ? bytememcmp : memcmp)(a, b, size);
+			break;
+		case 3:
+			sink = (byte ? bytestrlen : strlen)(a + (i & 3));
+			break;
+		}
+	}
+	clockgettime(CLOCK_MONOTONIC, &t1);
+	if((us = usdiff(&t0, &t1)) == 0)
+		us = 1;
+	return n * size / us;
+}
+
+void
+check(void)
+{
+	int i;
+
+	for(i = 0; i < 100; i++)
+		a[i] = i;
+	memmove(a + 3, a, 90);
+	memmove(a + 50, a + 53, 40);
+	for(i = 3; i < 50; i++)
+		if(a[i] != i - 3)
+			goto bad;
+	for(i = 50; i < 90; i++)
+		if(a[i] != i)
+			goto bad;
+	memset(a + 1, 'x', 37);
+	a[38] = 0;
+	if(strlen(a + 1) != 37 || strlen(a + 2) != 36)
+		goto bad;
+	memmove(b, a, 39);
+	if(memcmp(a, b, 39) != 0)
+		goto bad;
+	b[30] = 'y';
+	if(memcmp(a, b, 39) >= 0 || memcmp(b, a, 39) <= 0)
+		goto bad;
+	return;
+bad:
+	printf("strbench: wrong result\n");
+	exit();
+}
+
+int
+main(int argc, char *argv[])
+{
+	static char *names[] = { "memset ", "memmove", "memcmp ", "strlen " };
+	uint total;
+	int i, w;
+
+	check();
+	total = 4096 * 1024;
+	if(argc > 1 && atoi(argv[1]) > 0)
+		total = atoi(argv[1]) * 1024;
+
+	printf("routine size  byte-MB/s word-MB/s\n");
+	for(w = 0; w < 4; w++){
+		for(i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++){
+			// Equal buffers for memcmp, a NUL at size for strlen.
+			memset(a, 'x', MAXSIZE+4);
+			memset(b, 'x', MAXSIZE+4);
+			a[sizes[i]] = 0;
+			printf("%s %d  %d %d\n", names[w], sizes[i],
+			       run(w, 1, sizes[i], total), run(w, 0, sizes[i], total));
+		}
+	}
+	exit();
+}
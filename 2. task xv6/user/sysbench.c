@@ -0,0 +1,62 @@
+// Null system call cost through each kernel entry: getpid()
+// via int $T_SYSCALL/iret and via sysenter/sysexit.
+// Usage: sysbench [calls]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user.h"
+
+extern void *sysgate;  // usys.S
+extern char sysint[], sysfast[];
+
+static inline uint64
+rdtsc(void)
+{
+	uint64 val;
+	asm volatile("rdtsc" : "=A" (val));
+	return val;
+}
+
+void
+bench(char *what, void *gate, int n)
+{
+	uint64 t0;
+	int i, t, m;
+
+	sysgate = gate;
+	t = uptime();
+	t0 = rdtsc();
+	for(i = 0; i < n; i++)
+		getpid();
+	t0 = rdtsc() - t0;
+	t = uptime() - t;
+
+	// No 64-bit division without libgcc: scale both down.
+	for(m = n; t0 >> 32; m >>= 1)
+		t0 >>= 1;
+	printf("%s: %d calls in %d ticks, %d cycles each\n",
+	       what, n, t, m ? (uint)t0 / m : 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+	void *fast;
+	int n;
+
+	n = 1000000;
+	if(argc > 1)
+		n = atoi(argv[1]);
+	if(n < 1)
+		n = 1;
+
+	getpid();  // let usys.S pick its gate
+	fast = sysgate;
+	bench("int", sysint, n);
+	if(fast == sysfast)
+		bench("sysenter", sysfast, n);
+	else
+		printf("sysenter: not supported by this CPU\n");
+	sysgate = fast;
+	exit();
+}
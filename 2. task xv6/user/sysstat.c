@@ -0,0 +1,86 @@
+// Count system calls made by a command, like strace -c.
+// Usage: sysstat [-a] [-h] [command [args...]]
+// With a command, reset the counters, run it, and report the
+// calls it and its children made.  -a counts every process in
+// the system instead, -h adds each call's latency histogram.
+// Without a command, report what has been recorded so far.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/sysstat.h"
+#include "user.h"
+
+#define NSS 64
+
+struct sysstat ss[NSS];
+char pad[] = "            ";
+
+// Mean cycles per call, without overflowing kcycles*1024.
+uint
+avg(struct sysstat *s)
+{
+	if(s->kcycles >= (1<<22))
+		return s->kcycles / s->calls * 1024;
+	return s->kcycles * 1024 / s->calls;
+}
+
+int
+main(int argc, char *argv[])
+{
+	char path[32];
+	int all, hist, b, i, j, n, pid;
+	uint total;
+	struct sysstat t;
+
+	all = hist = 0;
+	for(i = 1; i < argc && argv[i][0] == '-'; i++){
+		if(strcmp(argv[i], "-a") == 0)
+			all = 1;
+		else if(strcmp(argv[i], "-h") == 0)
+			hist = 1;
+		else {
+			fprintf(2, "usage: sysstat [-a] [-h] [command [args...]]\n");
+			exit();
+		}
+	}
+
+	if(i < argc){
+		strcpy(path, "/bin/");
+		safestrcpy(path + 5, argv[i], sizeof(path) - 5);
+		sysstat(all ? SS_START : SS_CHILD, 0, 0);
+		if((pid = spawn(path, argv + i, 0)) < 0){
+			sysstat(SS_STOP, 0, 0);
+			fprintf(2, "sysstat: cannot run %s\n", path);
+			exit();
+		}
+		while(wait() != pid)
+			;
+		sysstat(SS_STOP, 0, 0);
+	}
+
+	// Most expensive calls first.
+	n = sysstat(SS_READ, ss, NSS);
+	total = 0;
+	for(i = 0; i < n; i++){
+		total += ss[i].kcycles;
+		t = ss[i];
+		for(j = i; j > 0 && ss[j-1].kcycles < t.kcycles; j--)
+			ss[j] = ss[j-1];
+		ss[j] = t;
+	}
+
+	// Pad names to a column; printf has no field widths.
+	printf("syscall      %%time calls errors kcycles avg-cycles\n");
+	for(i = 0; i < n; i++){
+		printf("%s%s %d %d %d %d %d\n", ss[i].name, pad + strlen(ss[i].name),
+		       total ? ss[i].kcycles * 100 / total : 0,
+		       ss[i].calls, ss[i].errors, ss[i].kcycles, avg(&ss[i]));
+		if(!hist)
+			continue;
+		for(b = 0; b < NSYSHIST; b++)
+			if(ss[i].hist[b])
+				printf("    %s%d cycles: %d\n", b == NSYSHIST-1 ? ">= " : "< ",
+				       1 << (b+1 < NSYSHIST ? b+1 : b), ss[i].hist[b]);
+	}
+	exit();
+}
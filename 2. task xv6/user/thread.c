@@ -0,0 +1,71 @@
+// Kernel-thread library: thread creation on top of clone()
+// and mutexes that sleep in the kernel through futexes.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user.h"
+#include "kernel/mmu.h"
+#include "kernel/x86.h"
+
+// clone() wants a page-aligned one-page stack, which malloc
+// does not promise.  Over-allocate, align, and keep the pointer
+// malloc returned in the word just below the aligned stack.
+int
+thread_create(void (*fn)(void*), void *arg)
+{
+	char *mem, *stack;
+	int tid;
+
+	if((mem = malloc(2*PGSIZE + sizeof(char*))) == 0)
+		return -1;
+	stack = (char*)PGROUNDUP((uint)mem + sizeof(char*));
+	((char**)stack)[-1] = mem;
+	if((tid = clone(fn, arg, stack)) < 0)
+		free(mem);
+	return tid;
+}
+
+// Wait for any other thread to finish and free its stack.
+// Returns the thread's id, or -1 if there are no threads left.
+int
+thread_join(void)
+{
+	void *stack;
+	int tid;
+
+	if((tid = join(&stack)) >= 0)
+		free(((char**)stack)[-1]);
+	return tid;
+}
+
+// Mutex after Drepper, "Futexes Are Tricky": the uncontended
+// paths are a single atomic instruction, and only a lock that
+// has been marked contended (2) pays for futexwake().
+
+void
+mutex_init(mutex_t *m)
+{
+	m->state = 0;
+}
+
+void
+mutex_lock(mutex_t *m)
+{
+	int c;
+
+	if((c = __sync_val_compare_and_swap(&m->state, 0, 1)) == 0)
+		return;
+	if(c != 2)
+		c = xchg((uint*)&m->state, 2);
+	while(c != 0){
+		futexwait(&m->state, 2);
+		c = xchg((uint*)&m->state, 2);
+	}
+}
+
+void
+mutex_unlock(mutex_t *m)
+{
+	if(xchg((uint*)&m->state, 0) == 2)
+		futexwake(&m->state, 1);
+}
@@ -0,0 +1,163 @@
+// Tests for clone()/join() threads and futex-based mutexes.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user.h"
+#include "kernel/fcntl.h"
+
+#define NTHREAD 4
+#define NITER   10000
+
+mutex_t lock;
+int counter;
+int fds[NTHREAD];
+char *heap[NTHREAD];
+
+void
+incr(void *arg)
+{
+	int i;
+
+	for(i = 0; i < NITER; i++){
+		mutex_lock(&lock);
+		counter++;
+		mutex_unlock(&lock);
+	}
+	exit();
+}
+
+// does a mutex keep concurrent increments from being lost?
+void
+mutextest(void)
+{
+	int i;
+
+	printf("mutex test\n");
+	mutex_init(&lock);
+	counter = 0;
+	for(i = 0; i < NTHREAD; i++)
+		if(thread_create(incr, 0) < 0){
+			printf("thread_create failed\n");
+			exit();
+		}
+	for(i = 0; i < NTHREAD; i++)
+		if(thread_join() < 0){
+			printf("thread_join failed\n");
+			exit();
+		}
+	if(thread_join() != -1){
+		printf("thread_join found too many threads\n");
+		exit();
+	}
+	if(counter != NTHREAD*NITER){
+		printf("counter %d, expected %d\n", counter, NTHREAD*NITER);
+		exit();
+	}
+	printf("mutex test ok\n");
+}
+
+void
+share(void *arg)
+{
+	int i = (int)arg;
+	char name[] = "thread0";
+
+	// Memory grown here must be visible to every thread.
+	if((heap[i] = sbrk(4096)) == (char*)-1)
+		exit();
+	heap[i][0] = 'a' + i;
+
+	// So must a file opened here.
+	name[6] += i;
+	fds[i] = open(name, O_CREATE|O_RDWR);
+	exit();
+}
+
+// do threads share sz and the open file table?
+void
+sharetest(void)
+{
+	int i;
+	char name[] = "thread0";
+
+	printf("share test\n");
+	for(i = 0; i < NTHREAD; i++)
+		thread_create(share, (void*)i);
+	for(i = 0; i < NTHREAD; i++)
+		thread_join();
+	for(i = 0; i < NTHREAD; i++){
+		if(heap[i] == 0 || heap[i] == (char*)-1 || heap[i][0] != 'a' + i){
+			printf("thread %d: sbrk memory not shared\n", i);
+			exit();
+		}
+		if(fds[i] < 0 || write(fds[i], "x", 1) != 1){
+			printf("thread %d: fd not shared\n", i);
+			exit();
+		}
+		close(fds[i]);
+		name[6] = '0' + i;
+		unlink(name);
+	}
+	printf("share test ok\n");
+}
+
+void
+spin(void *arg)
+{
+	for(;;)
+		;
+}
+
+// does exit() in the leader take running threads with it?
+void
+exittest(void)
+{
+	int pid;
+
+	printf("exit test\n");
+	pid = fork();
+	if(pid < 0){
+		printf("fork failed\n");
+		exit();
+	}
+	if(pid == 0){
+		thread_create(spin, 0);
+		thread_create(spin, 0);
+		sleep(10);
+		exit();
+	}
+	if(wait() != pid){
+		printf("wait failed\n");
+		exit();
+	}
+	printf("exit test ok\n");
+}
+
+// does futexwait() refuse to sleep on a stale value?
+void
+futextest(void)
+{
+	int word = 1;
+
+	printf("futex test\n");
+	if(futexwait(&word, 0) != -1){
+		printf("futexwait slept on a changed value\n");
+		exit();
+	}
+	if(futexwake(&word, 1) != 0){
+		printf("futexwake woke a phantom waiter\n");
+		exit();
+	}
+	printf("futex test ok\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+	futextest();
+	mutextest();
+	sharetest();
+	exittest();
+	printf("threadtest passed\n");
+	exit();
+}
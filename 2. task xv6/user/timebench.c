@@ -0,0 +1,64 @@
+// Compare reading the clock through clockgettime() with reading
+// it from the time page, and check that the two agree.
+// Usage: timebench [reads]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/memlayout.h"
+#include "kernel/clock.h"
+#include "user.h"
+
+// Nanoseconds from a to b, which must be less than 4 s apart.
+uint
+nsdiff(struct timespec *a, struct timespec *b)
+{
+	return (b->sec - a->sec) * 1000000000 + b->nsec - a->nsec;
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct timepage *tp = (struct timepage*)TIMEVA;
+	struct timespec t0, t1, ts, prev;
+	int i, n;
+
+	n = 100000;
+	if(argc > 1)
+		n = atoi(argv[1]);
+	if(n < 1)
+		n = 1;
+
+	printf("tsc %d kHz, booted at %d s since 1970\n",
+	       tp->tschz / 1000, tp->boottime);
+
+	clockgettime(CLOCK_MONOTONIC, &t0);
+	for(i = 0; i < n; i++)
+		clockgettime(CLOCK_MONOTONIC, &ts);
+	clockgettime(CLOCK_MONOTONIC, &t1);
+	printf("clockgettime: %d ns per read\n", nsdiff(&t0, &t1) / n);
+
+	clockread(tp, CLOCK_MONOTONIC, &t0);
+	prev = t0;
+	for(i = 0; i < n; i++){
+		clockread(tp, CLOCK_MONOTONIC, &ts);
+		if(ts.sec < prev.sec || (ts.sec == prev.sec && ts.nsec < prev.nsec)){
+			printf("timebench: time page went backwards\n");
+			exit();
+		}
+		prev = ts;
+	}
+	clockread(tp, CLOCK_MONOTONIC, &t1);
+	printf("time page: %d ns per read\n", nsdiff(&t0, &t1) / n);
+
+	// Both sources should read the same clock.
+	clockread(tp, CLOCK_MONOTONIC, &t0);
+	clockgettime(CLOCK_MONOTONIC, &ts);
+	clockread(tp, CLOCK_MONOTONIC, &t1);
+	if(nsdiff(&t0, &ts) > nsdiff(&t0, &t1)){
+		printf("timebench: clocks disagree\n");
+		exit();
+	}
+	clockgettime(CLOCK_REALTIME, &ts);
+	printf("realtime: %d s since 1970\n", ts.sec);
+	exit();
+}
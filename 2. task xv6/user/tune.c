@@ -0,0 +1,36 @@
+// Show the kernel's boot-time tunables: the value in effect,
+// the default, and the range the kernel command line may set.
+// Usage: tune
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/tune.h"
+#include "user.h"
+
+#define NTUNE 16
+
+struct tunable t[NTUNE];
+char pad[] = "            ";
+
+int
+main(int argc, char *argv[])
+{
+	int i, n;
+
+	if((n = tune(TN_READ, t, NTUNE)) < 0){
+		fprintf(2, "tune: cannot read tunables\n");
+		exit();
+	}
+
+	// Pad names to a column; printf has no field widths.
+	printf("tunable      value default range\n");
+	for(i = 0; i < n; i++){
+		printf("%s%s %d ", t[i].name, pad + strlen(t[i].name), t[i].val);
+		if(t[i].def)
+			printf("%d", t[i].def);
+		else
+			printf("auto");
+		printf(" %d-%d\n", t[i].min, t[i].max);
+	}
+	exit();
+}
@@ -51,23 +51,63 @@ strcmp(const char *p, const char *q)
 	return (uchar)*p - (uchar)*q;
 }
 
+// Word-at-a-time versions of the string routines, as in the
+// kernel's string.c.  strlen scans aligned words, which never
+// cross into an unmapped page.
 uint
 strlen(const char *s)
 {
-	int n;
+	const char *p;
+	const uint *w;
 
-	for(n = 0; s[n]; n++)
+	for(p = s; (uint)p & 3; p++)
+		if(*p == 0)
+			return p - s;
+	for(w = (const uint*)p; ((*w - 0x01010101) & ~*w & 0x80808080) == 0; w++)
 		;
-	return n;
+	for(p = (const char*)w; *p; p++)
+		;
+	return p - s;
 }
 
 void*
 memset(void *dst, int c, uint n)
 {
-	stosb(dst, c, n);
+	char *d;
+	uint k;
+
+	d = dst;
+	c &= 0xFF;
+	if(n >= 16){
+		k = -(uint)d & 3;
+		stosb(d, c, k);
+		d += k;
+		n -= k;
+		stosl(d, (uint)(uchar)c * 0x01010101, n/4);
+		d += n & ~3;
+		n &= 3;
+	}
+	stosb(d, c, n);
 	return dst;
 }
 
+int
+memcmp(const void *v1, const void *v2, uint n)
+{
+	const uchar *s1, *s2;
+
+	s1 = v1;
+	s2 = v2;
+	while(n >= 4 && *(uint*)s1 == *(uint*)s2)
+		s1 += 4, s2 += 4, n -= 4;
+	while(n-- > 0){
+		if(*s1 != *s2)
+			return *s1 - *s2;
+		s1++, s2++;
+	}
+	return 0;
+}
+
 char*
 strchr(const char *s, char c)
 {
@@ -125,10 +165,29 @@ memmove(void *vdst, const void *vsrc, int n)
 {
 	char *dst;
 	const char *src;
+	int d0, d1, d2;
 
 	dst = vdst;
 	src = vsrc;
-	while(n-- > 0)
-		*dst++ = *src++;
+	if(n <= 0)
+		return vdst;
+	if(src < dst && src + n > dst)
+		asm volatile("std; rep movsb\n\t"
+			     "subl $3, %%esi\n\t"
+			     "subl $3, %%edi\n\t"
+			     "movl %4, %%ecx\n\t"
+			     "shrl $2, %%ecx\n\t"
+			     "rep movsl; cld" :
+			     "=&c" (d0), "=&D" (d1), "=&S" (d2) :
+			     "0" (n & 3), "g" (n), "1" (dst + n - 1), "2" (src + n - 1) :
+			     "memory", "cc");
+	else
+		asm volatile("cld; rep movsl\n\t"
+			     "movl %4, %%ecx\n\t"
+			     "andl $3, %%ecx\n\t"
+			     "rep movsb" :
+			     "=&c" (d0), "=&D" (d1), "=&S" (d2) :
+			     "0" (n / 4), "g" (n), "1" (dst), "2" (src) :
+			     "memory", "cc");
 	return vdst;
 }
@@ -1,5 +1,12 @@
 struct stat;
 struct rtcdate;
+struct lockstat;
+struct irqstat;
+struct sysstat;
+struct bootstamp;
+struct tunable;
+struct ring;
+struct timespec;
 
 // system calls
 int fork(void);
@@ -27,6 +34,20 @@ int setecho(int);
 int setkey(int);
 int encr(int);
 int decr(int);
+int clone(void(*)(void*), void*, void*);
+int join(void**);
+int futexwait(int*, int);
+int futexwake(int*, int);
+int spawn(char*, char**, int*);
+int lockstat(int, struct lockstat*, int);
+int irqroute(int, int);
+int irqstat(struct irqstat*, int);
+struct ring* ringsetup(void);
+int ringenter(int, int);
+int clockgettime(int, struct timespec*);
+int sysstat(int, struct sysstat*, int);
+int bootstat(int, struct bootstamp*, int);
+int tune(int, struct tunable*, int);
 
 // ulib.c
 int stat(const char*, struct stat*);
@@ -41,6 +62,31 @@ void printf(const char*, ...);
 char* gets(char*, int max);
 uint strlen(const char*);
 void* memset(void*, int, uint);
+int memcmp(const void*, const void*, uint);
 void* malloc(uint);
 void free(void*);
 int atoi(const char*);
+
+// thread.c
+typedef struct {
+	int state;  // 0 unlocked, 1 locked, 2 locked with waiters
+} mutex_t;
+
+int thread_create(void(*)(void*), void*);
+int thread_join(void);
+void mutex_init(mutex_t*);
+void mutex_lock(mutex_t*);
+void mutex_unlock(mutex_t*);
+
+// uthread.c
+struct uthread;
+struct uchan;
+
+struct uthread* uthread_spawn(void(*)(void*), void*);
+void uthread_yield(void);
+void uthread_exit(void) __attribute__((noreturn));
+void uthread_join(struct uthread*);
+struct uchan* uchan_create(int);
+void uchan_free(struct uchan*);
+void uchan_send(struct uchan*, void*);
+void* uchan_recv(struct uchan*);
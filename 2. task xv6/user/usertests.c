@@ -300,6 +300,43 @@ exectest(void)
 	}
 }
 
+// spawn a child with its stdout remapped onto a pipe
+void
+spawntest(void)
+{
+	int fds[2], map[3], pid, n, tot;
+	char buf[32];
+
+	printf("spawn test\n");
+	if(pipe(fds) != 0){
+		printf("pipe() failed\n");
+		exit();
+	}
+	map[0] = -1;
+	map[1] = fds[1];
+	map[2] = 2;
+	if((pid = spawn("/bin/echo", echoargv, map)) < 0){
+		printf("spawn echo failed\n");
+		exit();
+	}
+	close(fds[1]);
+	tot = 0;
+	while((n = read(fds[0], buf + tot, sizeof(buf) - 1 - tot)) > 0)
+		tot += n;
+	buf[tot] = 0;
+	close(fds[0]);
+	if(wait() != pid || strcmp(buf, "ALL TESTS PASSED\n") != 0){
+		printf("spawn: wrong output %s\n", buf);
+		exit();
+	}
+	map[1] = 99;
+	if(spawn("/bin/echo", echoargv, map) >= 0){
+		printf("spawn accepted a bad fd\n");
+		exit();
+	}
+	printf("spawn test ok\n");
+}
+
 // simple fork and pipe read/write
 
 void
@@ -1383,7 +1420,7 @@ forktest(void)
 
 	printf("fork test\n");
 
-	for(n=0; n<1000; n++){
+	for(n=0; n<100000; n++){
 		pid = fork();
 		if(pid < 0)
 			break;
@@ -1391,8 +1428,8 @@ forktest(void)
 			exit();
 	}
 
-	if(n == 1000){
-		printf("fork claimed to work 1000 times!\n");
+	if(n == 100000){
+		printf("fork claimed to work 100000 times!\n");
 		exit();
 	}
 
@@ -1797,6 +1834,7 @@ main(int argc, char *argv[])
 
 	uio();
 
+	spawntest();
 	exectest();
 
 	exit();
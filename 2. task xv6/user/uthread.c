@@ -0,0 +1,258 @@
+// Green threads: cooperative user-level threads multiplexed on
+// one process.  A switch is a call to uswtch(), never a trap, so
+// thousands of tasks cost only their malloc'd stacks.
+//
+// Threads run until they call uthread_yield(), block in
+// uthread_join() or a channel, or finish.  Every thread must be
+// joined, since its stack is freed by the joiner.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user.h"
+
+#define USTACKSIZE 4096
+
+// Saved registers, laid out as uswtch.S pushes them.
+struct ucontext {
+	uint edi;
+	uint esi;
+	uint ebx;
+	uint ebp;
+	uint eip;
+};
+
+enum ustate { URUNNABLE, UBLOCKED, UDONE };
+
+struct uthread {
+	struct ucontext *context;  // uswtch() here to run thread
+	char *stack;               // Bottom of stack (0 for main)
+	enum ustate state;
+	void (*fn)(void*);
+	void *arg;
+	struct uthread *joiner;    // Thread waiting in uthread_join()
+	struct uthread *next;      // Run queue or channel wait queue
+};
+
+struct uqueue {
+	struct uthread *head;
+	struct uthread *tail;
+};
+
+struct uchan {
+	void **buf;
+	int cap;
+	int n;                // Values currently buffered
+	int r;                // Read index
+	struct uqueue sendq;  // Senders waiting for room
+	struct uqueue recvq;  // Receivers waiting for a value
+};
+
+void uswtch(struct ucontext**, struct ucontext*);
+
+static struct uthread mainthread;
+static struct uthread *current;
+static struct uqueue runq;
+
+static void
+enqueue(struct uqueue *q, struct uthread *t)
+{
+	t->next = 0;
+	if(q->tail)
+		q->tail->next = t;
+	else
+		q->head = t;
+	q->tail = t;
+}
+
+static struct uthread*
+dequeue(struct uqueue *q)
+{
+	struct uthread *t;
+
+	if((t = q->head) != 0){
+		q->head = t->next;
+		if(q->head == 0)
+			q->tail = 0;
+	}
+	return t;
+}
+
+static void
+uinit(void)
+{
+	if(current == 0){
+		mainthread.state = URUNNABLE;
+		current = &mainthread;
+	}
+}
+
+// Make t runnable again.
+static void
+ready(struct uthread *t)
+{
+	t->state = URUNNABLE;
+	enqueue(&runq, t);
+}
+
+// Switch to the next runnable thread.  The caller has already
+// queued current if it should run again.
+static void
+schedule(void)
+{
+	struct uthread *prev, *next;
+
+	if((next = dequeue(&runq)) == 0){
+		fprintf(2, "uthread: all threads blocked\n");
+		exit();
+	}
+	if(next == current)
+		return;
+	prev = current;
+	current = next;
+	uswtch(&prev->context, next->context);
+}
+
+// First code run by every new thread, entered from uswtch's ret.
+static void
+uthread_start(void)
+{
+	current->fn(current->arg);
+	uthread_exit();
+}
+
+struct uthread*
+uthread_spawn(void (*fn)(void*), void *arg)
+{
+	struct uthread *t;
+	struct ucontext *c;
+
+	uinit();
+	if((t = malloc(sizeof(*t))) == 0)
+		return 0;
+	if((t->stack = malloc(USTACKSIZE)) == 0){
+		free(t);
+		return 0;
+	}
+	t->fn = fn;
+	t->arg = arg;
+	t->joiner = 0;
+
+	// Build the frame uswtch() expects so that its ret lands
+	// in uthread_start.
+	c = (struct ucontext*)(t->stack + USTACKSIZE - sizeof(*c) - 4);
+	memset(c, 0, sizeof(*c));
+	c->eip = (uint)uthread_start;
+	t->context = c;
+
+	ready(t);
+	return t;
+}
+
+// Give up the processor to the next runnable thread.
+void
+uthread_yield(void)
+{
+	uinit();
+	ready(current);
+	schedule();
+}
+
+// Finish the current thread.  Does not return.
+void
+uthread_exit(void)
+{
+	uinit();
+	if(current == &mainthread)
+		exit();
+	current->state = UDONE;
+	if(current->joiner)
+		ready(current->joiner);
+	schedule();
+	fprintf(2, "uthread: exited thread ran\n");
+	exit();
+}
+
+// Wait for t to finish and free it.
+void
+uthread_join(struct uthread *t)
+{
+	uinit();
+	if(t->joiner || t == current){
+		fprintf(2, "uthread: bad join\n");
+		exit();
+	}
+	if(t->state != UDONE){
+		t->joiner = current;
+		current->state = UBLOCKED;
+		schedule();
+	}
+	free(t->stack);
+	free(t);
+}
+
+// Channels.  A channel buffers up to cap values; senders block
+// while it is full and receivers while it is empty.
+
+struct uchan*
+uchan_create(int cap)
+{
+	struct uchan *c;
+
+	if(cap < 1)
+		cap = 1;
+	if((c = malloc(sizeof(*c))) == 0)
+		return 0;
+	if((c->buf = malloc(cap * sizeof(void*))) == 0){
+		free(c);
+		return 0;
+	}
+	c->cap = cap;
+	c->n = 0;
+	c->r = 0;
+	c->sendq.head = c->sendq.tail = 0;
+	c->recvq.head = c->recvq.tail = 0;
+	return c;
+}
+
+void
+uchan_free(struct uchan *c)
+{
+	free(c->buf);
+	free(c);
+}
+
+void
+uchan_send(struct uchan *c, void *v)
+{
+	struct uthread *t;
+
+	uinit();
+	while(c->n == c->cap){
+		current->state = UBLOCKED;
+		enqueue(&c->sendq, current);
+		schedule();
+	}
+	c->buf[(c->r + c->n++) % c->cap] = v;
+	if((t = dequeue(&c->recvq)) != 0)
+		ready(t);
+}
+
+void*
+uchan_recv(struct uchan *c)
+{
+	struct uthread *t;
+	void *v;
+
+	uinit();
+	while(c->n == 0){
+		current->state = UBLOCKED;
+		enqueue(&c->recvq, current);
+		schedule();
+	}
+	v = c->buf[c->r];
+	c->r = (c->r + 1) % c->cap;
+	c->n--;
+	if((t = dequeue(&c->sendq)) != 0)
+		ready(t);
+	return v;
+}
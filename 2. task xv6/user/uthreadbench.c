@@ -0,0 +1,144 @@
+// Compare the cost of a green-thread switch with a kernel
+// process switch driven by fork and a pipe ping-pong.
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user.h"
+
+#define NYIELD  200000
+#define NCHAN   100000
+#define NPIPE   5000
+#define NTASK   1000
+
+void
+yielder(void *arg)
+{
+	int i;
+
+	for(i = 0; i < (int)arg; i++)
+		uthread_yield();
+}
+
+void
+report(char *what, int n, int ticks)
+{
+	printf("%s: %d switches in %d ticks", what, n, ticks);
+	if(ticks > 0)
+		printf(" (%d per tick)", n / ticks);
+	printf("\n");
+}
+
+// Two green threads yielding to each other.
+void
+yieldbench(void)
+{
+	struct uthread *a, *b;
+	int t0;
+
+	t0 = uptime();
+	a = uthread_spawn(yielder, (void*)(NYIELD/2));
+	b = uthread_spawn(yielder, (void*)(NYIELD/2));
+	uthread_join(a);
+	uthread_join(b);
+	report("uthread yield", NYIELD, uptime() - t0);
+}
+
+void
+pong(void *arg)
+{
+	struct uchan **c = arg;
+	int i;
+
+	for(i = 0; i < NCHAN/2; i++)
+		uchan_send(c[1], uchan_recv(c[0]));
+}
+
+// A value bounced between two green threads over channels.
+void
+chanbench(void)
+{
+	struct uchan *c[2];
+	struct uthread *t;
+	int i, t0;
+
+	c[0] = uchan_create(1);
+	c[1] = uchan_create(1);
+	t0 = uptime();
+	t = uthread_spawn(pong, c);
+	for(i = 0; i < NCHAN/2; i++){
+		uchan_send(c[0], (void*)i);
+		if((int)uchan_recv(c[1]) != i){
+			printf("chanbench: wrong value\n");
+			exit();
+		}
+	}
+	uthread_join(t);
+	report("uthread channel", NCHAN, uptime() - t0);
+	uchan_free(c[0]);
+	uchan_free(c[1]);
+}
+
+// Many tasks alive at once, each yielding a few times.
+void
+manybench(void)
+{
+	static struct uthread *t[NTASK];
+	int i, t0;
+
+	t0 = uptime();
+	for(i = 0; i < NTASK; i++)
+		if((t[i] = uthread_spawn(yielder, (void*)10)) == 0){
+			printf("manybench: spawn %d failed\n", i);
+			exit();
+		}
+	for(i = 0; i < NTASK; i++)
+		uthread_join(t[i]);
+	report("uthread x1000", NTASK*10, uptime() - t0);
+}
+
+// A byte bounced between two processes over two pipes.
+void
+pipebench(void)
+{
+	int p1[2], p2[2];
+	int i, pid, t0;
+	char c;
+
+	if(pipe(p1) < 0 || pipe(p2) < 0){
+		printf("pipebench: pipe failed\n");
+		exit();
+	}
+	t0 = uptime();
+	if((pid = fork()) < 0){
+		printf("pipebench: fork failed\n");
+		exit();
+	}
+	if(pid == 0){
+		for(i = 0; i < NPIPE/2; i++){
+			read(p1[0], &c, 1);
+			write(p2[1], &c, 1);
+		}
+		exit();
+	}
+	c = 'x';
+	for(i = 0; i < NPIPE/2; i++){
+		write(p1[1], &c, 1);
+		read(p2[0], &c, 1);
+	}
+	wait();
+	report("fork+pipe", NPIPE, uptime() - t0);
+	close(p1[0]);
+	close(p1[1]);
+	close(p2[0]);
+	close(p2[1]);
+}
+
+int
+main(int argc, char *argv[])
+{
+	yieldbench();
+	chanbench();
+	manybench();
+	pipebench();
+	exit();
+}